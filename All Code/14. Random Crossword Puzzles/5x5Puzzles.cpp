@@ -32,12 +32,17 @@ int   *first;  // Where words beginning with each letter start in the dictionary
 int   *last;   // Where words beginning with each letter end in the dictionary.
 char **words;  // The words in the dictionary.
 char **X;      // The current configuration as the Markov chain evolves.
-double AP[4];  // Proposed transition acceptance probabilities when deltaE > 0.
+double AP[7];  // Acceptance probabilities e^(-deltaE/T), stored in AP[deltaE+3].
 int    i0, j0; // Proposed site to change.
 char   X0;     // Proposed new letter.
+double HR;     // Hastings ratio of the proposed change.
+int    UseFrequencies;       // 1 if letters are proposed by dictionary frequency.
+double q[6][6][27];          // Proposal probability of letter '@'+k at site (i,j).
+double Cutoff[6][6][27];     // Walker alias table cutoffs for site (i,j).
+char   Alias[6][6][27];      // Walker alias table aliases for site (i,j).
 
 // Functions found below.
-void   Initialize ();
+void   Initialize (int);
 void   Metropolis (int);
 int    Energy ();
 int    BlackSquares ();
@@ -46,20 +51,57 @@ int    IsAWord (char, char, char, char, char);
 int    Twice ();
 void   MakeOutputFiles ();
 char   RandomLetter ();
+char   FrequentLetter (int, int);
+void   AliasTables ();
 void   Proposal ();
 
 #include "MetropolisFunctions.h"
 
+// These are POSIX functions for sockets and processes, used in daemon mode.
+#ifndef _WIN32
+#include <unistd.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+// Daemon mode functions found below.
+void   Daemon (char *, int);
+int    StartWorker (int, int);
+void   Worker (int, int);
+void   Serve (int);
+void   SendPuzzle (FILE *);
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////
 // Main program.
 ////////////////////////////////////////////////////////////////////////////////
-int main () {
+int main (int argc, char *argv[]) {
 
    int n;
 
+   // New letters are proposed uniformly at random unless "-frequency" comes
+   //   first on the command line; then they are proposed according to how
+   //   often each letter appears at that position in the dictionary's words.
+   //   For example: 5x5Puzzles -frequency
+   if (argc > 1 && strcmp (argv[1], "-frequency") == 0) {
+      UseFrequencies = 1;
+      argc --;
+      argv ++;
+   }
+
+#ifndef _WIN32
+   // If a socket name is given on the command line (and, optionally, the
+   //   number of worker processes), run as a daemon serving puzzles over that
+   //   socket. For example: 5x5Puzzles /tmp/crossword.sock 4
+   if (argc > 1) {
+      Daemon (argv[1], argc > 2 ? atoi (argv[2]) : 4);
+   }
+#endif
+
    // Read in the dictionary, etc.  Dictionary5.txt must be present
    //   in the same directory as the executable version of this software.
-   Initialize ();
+   Initialize (0);
 
    // Generate 10 random 5x5 puzzle solutions.
    for (n = 1; n <= 10; n++) {
@@ -109,18 +151,19 @@ void Metropolis (int n) {
       // Compute the change in energy.
       deltaE = Energy () - E;
 
-      // Keep change and update the energy if deltaE <= 0.
+      // Keep change and update the energy if deltaE <= 0 (and the Hastings
+      //    ratio HR is at least 1, which it always is for uniform proposals).
       AcceptTransition = 0;
-      if (deltaE <= 0) {
+      if (deltaE <= 0 && HR >= 1.0) {
          AcceptTransition = 1;
       }
 
-      // Otherwise keep with probability AP[deltaE] = e^(-deltaE/T).
+      // Otherwise keep with probability HR * AP[deltaE+3] = HR * e^(-deltaE/T).
       // Here T hardwired at 0.137 which was empirically found to be best.
       else {
 
          // Keep the proposed transition if accepted.
-         if (MTUniform () <= AP[deltaE]) {
+         if (MTUniform () <= HR * AP[deltaE+3]) {
             AcceptTransition = 1;
          }
 
@@ -148,7 +191,9 @@ void Metropolis (int n) {
 ////////////////////////////////////////////////////////////////////////////////
 void Proposal () {
 
-   // i0, j0, and X0 are global variables.
+   double p, r;
+
+   // i0, j0, X0, and HR are global variables.
 
    // Choose a random grid site (i0,j0) at random using the Mersenne Twister.
    // Will have i0 and j0 uniformly distributed on {1,2,3,4,5} --- independently.
@@ -160,7 +205,7 @@ void Proposal () {
 
    // ...Now randomly change it.
    while (1) {
-      X[i0][j0] = RandomLetter ();
+      X[i0][j0] = (UseFrequencies ? FrequentLetter (i0, j0) : RandomLetter ());
       // Accept this random letter only if it is different from the current
       //    letter (usually is).
       if (X[i0][j0] != X0) {
@@ -168,6 +213,17 @@ void Proposal () {
       }
    }
 
+   // The Hastings ratio. The new letter Y is proposed with probability
+   //    q(Y)/(1-q(X0)) and the reverse change with probability q(X0)/(1-q(Y)),
+   //    where q is the letter distribution at site (i0,j0). For uniform
+   //    proposals the ratio is 1.
+   HR = 1.0;
+   if (UseFrequencies) {
+      p = q[i0][j0][X0-'@'];
+      r = q[i0][j0][X[i0][j0]-'@'];
+      HR = (p * (1.0 - p)) / (r * (1.0 - r));
+   }
+
    return;
 }
 
@@ -211,7 +267,8 @@ int Energy () {
 
 ////////////////////////////////////////////////////////////////////////////////
 // This function:
-// (1) Seeds the random number generator;
+// (1) Seeds the random number generator, unless running as a daemon (each
+//      worker process then seeds its own, see Worker ());
 // (2) Reads in the dictionary of five-letter words;
 // (3) Allocates space for the Markov chain configuration X[][];
 // (4) Determines where in the dictionary words beginning with each letter
@@ -221,20 +278,26 @@ int Energy () {
 //      word beginning with H (see the function IsAWord, where this is used).
 // (5) Calculates acceptance probabilies when deltaE > 0.  This speeds up
 //      simulations.
+// (6) Asks how letters should be proposed and, if by dictionary frequency,
+//      builds the alias tables used to propose them.
 ////////////////////////////////////////////////////////////////////////////////
-void Initialize () {
+void Initialize (int daemon) {
 
    int i, k, n, deltaE;
    char input[100];
    FILE *fp;
 
-   printf ("I will generate 10 random solutions to 5x5 crossword puzzles.\n\n");
-   printf ("For each puzzle I will generate a TeX file (Puzzle.tex) which, when\n");
-   printf ("processed with Plain TeX, will generate a beautiful puzzle for you!\n");
+   if (!daemon) {
+
+      printf ("I will generate 10 random solutions to 5x5 crossword puzzles.\n\n");
+      printf ("For each puzzle I will generate a TeX file (Puzzle.tex) which, when\n");
+      printf ("processed with Plain TeX, will generate a beautiful puzzle for you!\n");
 
-   // (1)
-   // Seed the Mersenne Twister.
-   MTUniform ();
+      // (1)
+      // Seed the Mersenne Twister.
+      MTUniform ();
+
+   }
 
    // (2)
    // Open the dictionary. This dictionary of five letter words was compiled by
@@ -340,13 +403,22 @@ void Initialize () {
    }
 
    // (5)
-   // Calculate the probability of accepting proposed transitions when the
-   //   change in energy is positive.  This uses that, when positive, deltaE can
-   //   only take on the values 1, 2, and 3. The temperature is hard-wired at 0.137.
+   // Calculate e^(-deltaE/T), which is used to compute the probability of
+   //   accepting proposed transitions. Changing one letter changes at most two
+   //   words, so deltaE can only take on the values -3, -2, ..., 3. The value
+   //   for deltaE is stored in AP[deltaE+3]. The temperature is hard-wired at 0.137.
    // Calculation of these values ahead of time speeds up simulation of the Markov
    //   chain.
-   for (deltaE = 1; deltaE <= 3; deltaE++) {
-      AP[deltaE] = exp (-deltaE / 0.137);
+   for (deltaE = -3; deltaE <= 3; deltaE++) {
+      AP[deltaE+3] = exp (-deltaE / 0.137);
+   }
+
+   // (6)
+   // With "-frequency" on the command line (see main ()), set up the tables for
+   //   proposing letters by dictionary frequency.
+   if (UseFrequencies) {
+      printf ("\nI will propose new letters by how often they appear in the dictionary.\n");
+      AliasTables ();
    }
 
    return;
@@ -515,7 +587,293 @@ char RandomLetter () {
 
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Build the letter distribution q[i][j][*] for each grid site (i,j) and its
+//    Walker alias table.
+// The letter at site (i,j) is the j^th letter of a row word and the i^th
+//    letter of a column word, so q[i][j][k] is proportional to the number of
+//    dictionary words with letter '@'+k in position j plus the number with it
+//    in position i. One is added to each count so that every letter can be
+//    proposed; otherwise the Markov chain could not reach every puzzle.
+// With the alias table a letter is drawn in constant time: pick a column k
+//    uniformly from {0,...,26}; keep letter '@'+k with probability Cutoff[k],
+//    otherwise take Alias[k].
+////////////////////////////////////////////////////////////////////////////////
+void AliasTables () {
+
+   int i, j, k, n, s, nSmall, nLarge;
+   int count[6][27], small[27], large[27];
+   double total, P[27];
+
+   // Count how often each letter appears in each position of a word.
+   for (j = 1; j <= 5; j++) {
+      for (k = 0; k <= 26; k++) {
+         count[j][k] = 0;
+      }
+   }
+   for (n = 1; n <= N; n++) {
+      for (j = 1; j <= 5; j++) {
+         count[j][words[n][j-1]-'@'] ++;
+      }
+   }
+
+   for (i = 1; i <= 5; i++) {
+      for (j = 1; j <= 5; j++) {
+
+         // The letter distribution at site (i,j).
+         total = 0;
+         for (k = 0; k <= 26; k++) {
+            q[i][j][k] = count[j][k] + count[i][k] + 1;
+            total += q[i][j][k];
+         }
+         for (k = 0; k <= 26; k++) {
+            q[i][j][k] /= total;
+         }
+
+         // Split the scaled probabilities 27 * q into those below 1 ("small")
+         //    and those at least 1 ("large").
+         nSmall = nLarge = 0;
+         for (k = 0; k <= 26; k++) {
+            P[k] = 27 * q[i][j][k];
+            if (P[k] < 1.0) small[nSmall++] = k;
+            else            large[nLarge++] = k;
+         }
+
+         // Fill each small column up to 1 with probability from a large one.
+         while (nSmall > 0 && nLarge > 0) {
+            s = small[--nSmall];
+            k = large[nLarge-1];
+            Cutoff[i][j][s] = P[s];
+            Alias[i][j][s] = '@' + k;
+            P[k] -= 1.0 - P[s];
+            if (P[k] < 1.0) {
+               nLarge --;
+               small[nSmall++] = k;
+            }
+         }
+
+         // Whatever is left over is full (up to round-off error).
+         while (nLarge > 0) {
+            k = large[--nLarge];
+            Cutoff[i][j][k] = 1.0;
+            Alias[i][j][k] = '@' + k;
+         }
+         while (nSmall > 0) {
+            k = small[--nSmall];
+            Cutoff[i][j][k] = 1.0;
+            Alias[i][j][k] = '@' + k;
+         }
+
+      }
+   }
+
+   return;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Generate a letter for site (i,j) according to the letter distribution
+//    q[i][j][*], using that site's alias table.
+////////////////////////////////////////////////////////////////////////////////
+char FrequentLetter (int i, int j) {
+
+   int k;
+
+   k = RandomInteger (0, 26);
+   if (MTUniform () < Cutoff[i][j][k]) {
+      return (char) ('@' + k);
+   }
+
+   return Alias[i][j][k];
+
+}
+
+#ifndef _WIN32
+
+////////////////////////////////////////////////////////////////////////////////
+// Serve puzzles over the Unix-domain socket "path" with "workers" worker
+//    processes. The dictionary and alias tables are built once, before the
+//    workers are started, so a request costs only the Markov chain time.
+// The protocol is line-based. A client sends
+//    FILL         for one puzzle, or
+//    FILL k       for k puzzles (1 <= k <= 100),
+// and for each puzzle gets back its five rows, one per line, with '@' for a
+//    black square; "END" follows the last puzzle. QUIT closes the connection.
+// The workers share the listening socket, so each one accepts and serves a
+//    connection while the others wait for the next. A worker that dies is
+//    replaced. This function never returns.
+////////////////////////////////////////////////////////////////////////////////
+void Daemon (char *path, int workers) {
+
+   int w, seed, listener, *pid;
+   pid_t done;
+   struct sockaddr_un address;
 
+   if (workers < 1) workers = 1;
 
+   printf ("I will serve random 5x5 crossword puzzles on socket %s\n", path);
+   printf ("with %d worker processes.\n", workers);
+
+   // Worker number w seeds its Mersenne Twister with seed + w - 1.
+   seed = GetInteger ("\nPlease seed the Mersenne Twister with a positive integer... ");
+
+   // Read in the dictionary, etc., once for all workers.
+   Initialize (1);
+
+   // Set up the listening socket, removing any left over from an earlier run.
+   listener = socket (AF_UNIX, SOCK_STREAM, 0);
+   memset (&address, 0, sizeof (address));
+   address.sun_family = AF_UNIX;
+   strncpy (address.sun_path, path, sizeof (address.sun_path) - 1);
+   unlink (path);
+   if (listener < 0 || bind (listener, (struct sockaddr *) &address, sizeof (address)) < 0
+                    || listen (listener, 64) < 0) {
+      printf ("I cannot listen on socket %s.\n", path);
+      exit (1);
+   }
 
+   // Writing to a client that has hung up should not kill a worker.
+   signal (SIGPIPE, SIG_IGN);
+
+   // Start the workers. pid[w] is 0 for a worker that could not be started.
+   pid = (int *) calloc (workers + 1, sizeof (int));
+   for (w = 1; w <= workers; w++) {
+      pid[w] = StartWorker (listener, seed + w - 1);
+   }
+   printf ("\nReady.\n");
+   fflush (stdout);
+
+   // Replace any worker that dies, giving it a fresh seed, and try again to
+   //    start any that could not be started before.
+   while (1) {
+      done = wait (NULL);
+      if (done < 0) {
+         printf ("No worker processes are left; I am giving up.\n");
+         exit (1);
+      }
+      seed += workers;
+      for (w = 1; w <= workers; w++) {
+         if (pid[w] == done || pid[w] == 0) {
+            pid[w] = StartWorker (listener, seed + w - 1);
+         }
+      }
+   }
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Fork a worker process with the given seed. Return its process id, or 0 (after
+//    saying so) if it could not be started.
+////////////////////////////////////////////////////////////////////////////////
+int StartWorker (int listener, int seed) {
+
+   int id;
+
+   fflush (stdout);
+   id = fork ();
+   if (id == 0) {
+      Worker (listener, seed);
+   }
+   if (id < 0) {
+      printf ("I could not start a worker process.\n");
+      fflush (stdout);
+      id = 0;
+   }
+
+   return id;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// A worker process: seed the RNG, then accept and serve connections forever.
+////////////////////////////////////////////////////////////////////////////////
+void Worker (int listener, int seed) {
+
+   int connection;
+
+   // Give every worker its own stream of random numbers.
+   MTSeed (seed);
+
+   while (1) {
+      connection = accept (listener, NULL, NULL);
+      if (connection >= 0) {
+         Serve (connection);
+      }
+   }
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Answer the requests arriving on one client connection until it closes.
+////////////////////////////////////////////////////////////////////////////////
+void Serve (int connection) {
+
+   int n, k;
+   char input[100];
+   FILE *in, *out;
+
+   in  = fdopen (connection, "r");
+   out = fdopen (dup (connection), "w");
+
+   while (fgets (input, 99, in) != NULL) {
+
+      if (strncmp (input, "FILL", 4) == 0) {
+
+         // Number of puzzles requested; one if not given.
+         k = 1;
+         sscanf (input+4, "%d", &k);
+         if (k < 1 || k > 100) {
+            fprintf (out, "ERROR between 1 and 100 puzzles please\n");
+         }
+
+         else {
+            for (n = 1; n <= k; n++) {
+               Metropolis (n);
+               SendPuzzle (out);
+            }
+            fprintf (out, "END\n");
+         }
+
+      }
+
+      else if (strncmp (input, "QUIT", 4) == 0) {
+         break;
+      }
+
+      else {
+         fprintf (out, "ERROR unknown request\n");
+      }
+
+      fflush (out);
+
+   }
+
+   fclose (in);
+   fclose (out);
+
+   printf ("\n");
+   fflush (stdout);
+
+   return;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Send the current puzzle X[][] to a client, one row per line.
+////////////////////////////////////////////////////////////////////////////////
+void SendPuzzle (FILE *out) {
+
+   int i, j;
+
+   for (i = 1; i <= 5; i++) {
+      for (j = 1; j <= 5; j++) {
+         fputc (X[i][j], out);
+      }
+      fputc ('\n', out);
+   }
+
+   return;
+
+}
 
+#endif
@@ -25,49 +25,159 @@ SOFTWARE.
 ////////////////////////////////////////////////////////////////////////////////
 // Metropolis KenKen solver. See Section 15. The data file PuzzleA is
 // for the puzzle shown in the text.  Look for 7x7 KenKen puzzles
-// in the New York Time Magazine.
+// in the New York Time Magazine. Puzzles of any size up to 9x9 can be solved;
+// the size is read from the puzzle file.
 ////////////////////////////////////////////////////////////////////////////////
 
-// Global variables.
-int **puzzle, *x1, I0, I1, *ans, **N;
+// Global variables. The puzzle is size x size.
+int **puzzle, *x1, I0, I1, *ans, size;
 char *op;
 double T, *prob;
 
+// Bookkeeping for computing changes in energy incrementally.
+int *cage,       // cage[k] is the region containing square k.
+    **rowCount,  // rowCount[r][i] is the number of i's in row r.
+    **colCount,  // colCount[c][i] is the number of i's in column c.
+    *cageSum,    // Sum of the digits in each region.
+    *cageProd,   // Product of the digits in each region.
+    *cageMiss;   // cageMiss[k] is 1 if region k misses its target, 0 if not.
+
+// Cage moves, which rewrite a whole region at once.
+int ***tuple,    // tuple[k][t][i] is the digit in region k's i^th square in
+                 //    the t^th way of filling region k that hits its target.
+    *nTuples,    // The number of such ways for region k.
+    G0,          // The region a cage move rewrote; 0 if the move was a swap.
+    *saved;      // The digits region G0 held before it was rewritten.
+double pCage;    // Probability that a proposal is a cage move.
+
+// In the row model (rowModel = 1) every row always holds the digits 1,...,size
+//    and swaps stay within a row.
+int rowModel;
+
+// The number of steps the chain took and the seconds it ran.
+int steps;
+double seconds;
+
+// 1 in a batch mode worker process (see Solve ()), which has nobody to answer
+//    Exit ()'s prompt; see Quit ().
+int worker;
+
+// The exit status of a batch mode worker whose puzzle cannot be read or has
+//    no solution.
+#define UNREADABLE 2
+#define UNSOLVABLE 3
+
+// Constraint propagation done before the chain starts.
+int *cand,       // Bit d of cand[k] is set if digit d may still go in square k.
+    *freeSq,     // The squares with more than one candidate, freeSq[1],...,
+    nFree,       //    freeSq[nFree].
+    **rowFree;   // rowFree[r][1],...,rowFree[r][rowFree[r][0]] are the
+                 //    squares in row r with more than one candidate.
+
 void GetPuzzle ();
+void GetParameters ();
 void Initialize ();
-void Neighbors ();
-int  Region (int);
 int  Energy ();
 int  Operation (int);
+int  Evaluate (char, int *, int);
+int  CageValue (int);
+void CageTuples ();
+int  Enumerate (int, int, int *, int);
+int  IsTuple (int);
+void StartCages ();
+void StartRows ();
+int  FillRow (int, int, int);
+int  Presolve ();
+int  CageProposal ();
+void Tallies ();
+int  Tally (int *, int, int);
+int  SetSquare (int, int);
 void Probabilities ();
-void Proposal ();
+int  Proposal ();
 void ChangeBack ();
 void Metropolis ();
-void Report ();
+void Report (const char *);
 void AllocateMemory ();
+void Quit (int);
 
 // These functions are in common among all metropolis applications.
 #include "MetropolisFunctions.h"
 
+// This one needs FILE, from stdio.h.
+void ReadPuzzle (FILE *);
+
+// These are POSIX functions for files and processes, used in batch mode.
+#ifndef _WIN32
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+// Batch mode functions found below.
+void Batch (int, char **);
+int  AddPuzzles (char *, char **, int);
+char **OutputNames (char **, int);
+void Solve (int, char *, char *, int);
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////////
 // Main program.
 ////////////////////////////////////////////////////////////////////////////////////
-int main () {
+int main (int argc, char *argv[]) {
 
    // Allocate array space.
    AllocateMemory ();
 
+#ifndef _WIN32
+   // If puzzle files or directories of them are given on the command line,
+   //    solve them all in batch mode. For example: KenKen Puzzle1.txt daily
+   if (argc > 1) {
+      Batch (argc, argv);
+      Exit ();
+   }
+#endif
+
    // Get the puzzle and initialize the configuration.
    GetPuzzle ();
 
+   // Get the temperature, etc., unless the puzzle is already solved.
+   if (nFree > 0) GetParameters ();
+
    // Solve the puzzle via Metropolis.
    Metropolis ();
 
    // Set up the output files.
-   Report ();
+   Report ("Puzzle");
+   printf ("View the puzzle and solution using plain TeX with KK.tex.\n");
 
    // Pause so the window doesn't close.
-   Pause ();
+   Exit ();
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Get the parameters of the Markov chain.
+////////////////////////////////////////////////////////////////////////////////////
+void GetParameters () {
+
+   // Get the temperature parameter.
+   T = GetDouble ("\nWhat is the temperature parameter (.5 seems ok)?... ");
+
+   // Compute acceptance probabilities.
+   if (T > 0) Probabilities ();
+
+   // Get the model: either any digit may be anywhere (with each digit used
+   //    "size" times), or every row holds each digit once.
+   rowModel = GetInteger ("\nShould every row always hold each digit once (1) or not (0)?... ");
+
+   // Get the fraction of proposals that are cage moves. Cage moves would
+   //    break up the rows in the row model, so they are not used there.
+   pCage = 0;
+   if (!rowModel) {
+      pCage = GetDouble ("\nWhat fraction of proposals should rewrite a whole region (0 for none)?... ");
+   }
+
+   return;
 
 }
 
@@ -78,18 +188,27 @@ void Metropolis () {
 
    int E, deltaE, AcceptTransition;
    int n = 0;
+   double t0;
 
-   // Get the temperature parameter.
-   T = GetDouble ("\nWhat is the temperature parameter (.5 seems ok)?... ");
+   steps = 0;
+   seconds = 0;
 
-   // Compute acceptance probabilities.
-   if (T > 0) Probabilities ();
+   // Constraint propagation may already have pinned down every square.
+   if (nFree == 0) {
+      printf ("\nSolved by constraint propagation alone.\n\n");
+      return;
+   }
 
    // Time the calculations.
-   Time ();
+   t0 = Time ();
+
+   // With cage moves, start with every region hitting its target.
+   if (pCage > 0) StartCages ();
    
-   // Calculate the energy for the initial configuration.
+   // Calculate the energy for the initial configuration, and the row, column
+   //    and region tallies used to compute changes in energy.
    E = Energy ();
+   Tallies ();
 
    // Keep going until the solution is found.
    while (E > 0) {
@@ -97,11 +216,14 @@ void Metropolis () {
       // Count Markov chain steps.
       n ++;
 
-      // Propose a random change to the current configuration.
-      Proposal ();
-
-      // Compute the resulting change in energy.
-      deltaE = Energy () - E;
+      // Propose a random change to the current configuration and compute the
+      //    resulting change in energy. It is either a swap of two squares or,
+      //    with probability pCage, a rewrite of a whole region.
+      if (pCage > 0 && MTUniform () < pCage) {
+         deltaE = CageProposal ();
+      } else {
+         deltaE = Proposal ();
+      }
 
       // Start with the zero temperature dynamics.
       AcceptTransition = 0;
@@ -140,8 +262,11 @@ void Metropolis () {
 
    }
 
+   steps = n;
+   seconds = Time () - t0;
+
    printf ("\nSolved after %.1f million steps of the Markov chain in %.1f seconds.\n\n",
-   n/1000000.0, Time());
+   n/1000000.0, seconds);
 
    return;
 
@@ -152,33 +277,178 @@ void Metropolis () {
 ////////////////////////////////////////////////////////////////////////////////////
 void ChangeBack () {
 
-   int temp;
+   int i, *p, temp;
+
+   // Undo a cage move.
+   if (G0) {
+      p = puzzle[G0];
+      for (i = 1; i <= p[0]; i++) {
+         SetSquare (p[i], saved[i]);
+      }
+      return;
+   }
 
+   // Undo a swap.
    temp = x1[I0];
-   x1[I0] = x1[I1];
-   x1[I1] = temp;
+   SetSquare (I0, x1[I1]);
+   SetSquare (I1, temp);
 
 }
 
 ////////////////////////////////////////////////////////////////////////////////////
 // Propose a random change to the configuration.
-// Pick two grid sites with different digits and swap their digits.
+// Pick two grid sites with different digits and swap their digits. In the row
+//    model the two sites are in the same row, so every row still holds each
+//    digit once and the rows contribute nothing to the energy.
+// Only squares that constraint propagation left open are picked, and a swap
+//    that would put a digit where it has been ruled out is rejected: the
+//    configuration is left unchanged. The reverse of an allowed swap is the
+//    same swap, so the proposal stays symmetric.
+// Returns the resulting change in energy.
 ////////////////////////////////////////////////////////////////////////////////////
-void Proposal () {
+int Proposal () {
+
+   int temp, r, t, *f;
+
+   // This is not a cage move.
+   G0 = 0;
 
-   int temp;
+   if (rowModel) {
+      // Every row with an open square has at least two.
+      r = RandomInteger (0, size-1);
+      while (rowFree[r][0] < 2) {
+         r = RandomInteger (0, size-1);
+      }
+      f = rowFree[r];
+      I0 = f[RandomInteger (1, f[0])];
+      I1 = I0;
+      while (I1 == I0) {
+         I1 = f[RandomInteger (1, f[0])];
+      }
+   }
 
-   I0 = RandomInteger (1, 49);
+   else {
+      // Every open square may hold the same digit (cage moves change which
+      //    digits are used), so give up after nFree draws and count the step
+      //    as one with no change.
+      I0 = freeSq[RandomInteger (1, nFree)];
+      I1 = I0;
+      for (t = 0; t < nFree && x1[I1] == x1[I0]; t++) {
+         I1 = freeSq[RandomInteger (1, nFree)];
+      }
+      if (x1[I1] == x1[I0]) {
+         I1 = I0;
+         return 0;
+      }
+   }
 
-   I1 = I0;
-   while (x1[I1] == x1[I0]) {
-      I1 = RandomInteger (1, 49);
+   // Reject a swap that breaks a square's candidates.
+   if (!(cand[I0] & (1 << x1[I1])) || !(cand[I1] & (1 << x1[I0]))) {
+      I1 = I0;
+      return 0;
    }
 
    // Swap digits at sites I0 and I1.
    temp = x1[I0];
-   x1[I0] = x1[I1];
-   x1[I1] = temp;
+   return SetSquare (I0, x1[I1]) + SetSquare (I1, temp);
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Put digit v in square k and return the resulting change in energy.
+// Only square k's row, column, and region are affected, and their tallies are
+//    updated here, so this takes the same time however big the puzzle is.
+////////////////////////////////////////////////////////////////////////////////////
+int SetSquare (int k, int v) {
+
+   int u, r, c, g, miss, deltaE;
+
+   // The digit being replaced.
+   u = x1[k];
+
+   // Square k's row and column.
+   r = (k-1) / size + 1;
+   c = (k-1) % size + 1;
+
+   // Row r and column c each lose a u and gain a v.
+   deltaE  = Tally (rowCount[r], u, -1) + Tally (rowCount[r], v, +1);
+   deltaE += Tally (colCount[c], u, -1) + Tally (colCount[c], v, +1);
+
+   // Put v in square k and update its region's sum and product.
+   x1[k] = v;
+   g = cage[k];
+   cageSum[g] += v - u;
+   cageProd[g] = cageProd[g] / u * v;
+
+   // See if the region now hits its target.
+   miss = (CageValue (g) != ans[g]);
+   deltaE += miss - cageMiss[g];
+   cageMiss[g] = miss;
+
+   return deltaE;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Add "step" (+1 or -1) to count[i] and return the change in |count[i] - 1|,
+//    which is that row's or column's contribution to the energy.
+////////////////////////////////////////////////////////////////////////////////////
+int Tally (int *count, int i, int step) {
+
+   int before;
+
+   before = abs (count[i] - 1);
+   count[i] += step;
+
+   return abs (count[i] - 1) - before;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Compute the row and column tallies and each region's sum, product, and
+//    whether it misses its target, from scratch.
+////////////////////////////////////////////////////////////////////////////////////
+void Tallies () {
+
+   int i, k, r, c;
+
+   for (r = 1; r <= size; r++) {
+      for (i = 0; i <= size; i++) {
+         rowCount[r][i] = colCount[r][i] = 0;
+      }
+   }
+
+   for (k = 1; k <= size*size; k++) {
+      r = (k-1) / size + 1;
+      c = (k-1) % size + 1;
+      rowCount[r][x1[k]] ++;
+      colCount[c][x1[k]] ++;
+   }
+
+   for (k = 1; k <= puzzle[0][0]; k++) {
+      cageSum[k] = 0;
+      cageProd[k] = 1;
+      for (i = 1; i <= puzzle[k][0]; i++) {
+         cageSum[k] += x1[puzzle[k][i]];
+         cageProd[k] *= x1[puzzle[k][i]];
+      }
+      cageMiss[k] = (CageValue (k) != ans[k]);
+   }
+
+   return;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// The result of region k's operation, using its running sum or product when
+//    possible. Subtraction and division regions have only two squares.
+////////////////////////////////////////////////////////////////////////////////////
+int CageValue (int k) {
+
+   if (op[k] == '+') return cageSum[k];
+   if (op[k] == '*') return cageProd[k];
+
+   return Operation (k);
 
 }
 
@@ -191,7 +461,9 @@ void Probabilities () {
 
    int deltaE;
 
-   for (deltaE = 1; deltaE <= 10; deltaE++) {
+   // A swap changes the energy by at most 10. A cage move can change it by
+   //    up to 4 for each square in the region, plus 1.
+   for (deltaE = 1; deltaE <= 325; deltaE++) {
       prob[deltaE] = exp (-deltaE/T);
    }
 
@@ -204,41 +476,41 @@ void Probabilities () {
 ////////////////////////////////////////////////////////////////////////////////////
 int Energy () {
 
-   int count[8];
+   int count[10];
    int E, c, k, r, i;
 
   // Initialize.
    E = 0;
 
-   // Column deviations from {1,2,3,4,5,6,7}.
-   for (c = 1; c <= 7; c++) {
-      for (i = 0; i <= 7; i++) {
+   // Column deviations from {1,2,...,size}.
+   for (c = 1; c <= size; c++) {
+      for (i = 0; i <= size; i++) {
          count[i] = 0;
       }
       k = c;
       count[x1[k]] ++;
-      for (r = 2; r <= 7; r++) {
-         k += 7;
+      for (r = 2; r <= size; r++) {
+         k += size;
          count[x1[k]] ++;
       }
 
-      for (i = 1; i <= 7; i++) {
+      for (i = 1; i <= size; i++) {
          E += abs(count[i] - 1);
       }
    }   
 
-   // Row deviations from {1,2,3,4,5,6,7}.
+   // Row deviations from {1,2,...,size}.
    k = 0;
-   for (r = 1; r <= 7; r++) {
-      for (i = 0; i <= 7; i++) {
+   for (r = 1; r <= size; r++) {
+      for (i = 0; i <= size; i++) {
          count[i] = 0;
       }
-      for (c = 1; c <= 7; c++) {
+      for (c = 1; c <= size; c++) {
          k ++;
          count[x1[k]] ++;
       }
 
-      for (i = 1; i <= 7; i++) {
+      for (i = 1; i <= size; i++) {
          E += abs(count[i] - 1);
       }
    }
@@ -257,44 +529,58 @@ int Energy () {
 ////////////////////////////////////////////////////////////////////////////////////
 int Operation (int k) {
 
-   int *p, i, answer;
+   int *p, i, v[82];
 
    p = puzzle[k];
+   for (i = 1; i <= p[0]; i++) {
+      v[i] = x1[p[i]];
+   }
+
+   return Evaluate (op[k], v, p[0]);
+
+}
 
-   if (op[k] == '+') {
+////////////////////////////////////////////////////////////////////////////////////
+// Perform operation o on the n digits v[1],...,v[n].
+////////////////////////////////////////////////////////////////////////////////////
+int Evaluate (char o, int *v, int n) {
+
+   int i, answer;
+
+   if (o == '+') {
       answer = 0;
-      for (i = 1; i <= p[0]; i++) {
-         answer += x1[p[i]];
+      for (i = 1; i <= n; i++) {
+         answer += v[i];
       }
    }
 
-   else if (op[k] == '-') {
-      answer = x1[p[1]];
-      for (i = 2; i <= p[0]; i++) {  // p[0] should be 2 here.
-         answer -= x1[p[i]];
+   else if (o == '-') {
+      answer = v[1];
+      for (i = 2; i <= n; i++) {  // n should be 2 here.
+         answer -= v[i];
          if (answer < 0) answer *= -1;
       }
    }
 
-   else if (op[k] == '*') {
+   else if (o == '*') {
       answer = 1;
-      for (i = 1; i <= p[0]; i++) {
-         answer *= x1[p[i]];
+      for (i = 1; i <= n; i++) {
+         answer *= v[i];
       }
    }
 
-   else if (op[k] == '/') { // division, p[0] should be 2.
+   else if (o == '/') { // division, n should be 2.
       answer = -1;
-      if (x1[p[1]] % x1[p[2]] == 0) {
-         answer = x1[p[1]] / x1[p[2]];
-      } else if (x1[p[2]] % x1[p[1]] == 0) {
-         answer = x1[p[2]] / x1[p[1]];
+      if (v[1] % v[2] == 0) {
+         answer = v[1] / v[2];
+      } else if (v[2] % v[1] == 0) {
+         answer = v[2] / v[1];
       } 
    }
 
    else {
       printf ("Cannot find operation.\n");
-      Exit ();
+      Quit (UNREADABLE);
    }   
 
    return answer;
@@ -302,35 +588,356 @@ int Operation (int k) {
 }
 
 ////////////////////////////////////////////////////////////////////////////////////
-// Construct initial random configuration.
+// For each region, list every way of filling its squares with digits that
+//    hits the region's target and repeats no digit within a row or column.
 ////////////////////////////////////////////////////////////////////////////////////
-void Initialize () {
+void CageTuples () {
+
+   int k, t, v[82];
+
+   for (k = 1; k <= puzzle[0][0]; k++) {
+
+      // First count the ways, then allocate space and record them.
+      nTuples[k] = Enumerate (k, 1, v, 0);
+      tuple[k] = (int **) calloc (nTuples[k] + 1, sizeof (int *));
+      for (t = 1; t <= nTuples[k]; t++) {
+         tuple[k][t] = (int *) calloc (puzzle[k][0] + 1, sizeof (int));
+      }
+      nTuples[k] = 0;
+      Enumerate (k, 1, v, 1);
+
+   }
+
+   return;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Try every digit in the i^th square of region k, given the digits v[1],...,
+//    v[i-1] already placed in its earlier squares. Returns how many ways of
+//    filling the rest of the region work. If "record" is 1, each way found is
+//    also added to the list tuple[k][*].
+////////////////////////////////////////////////////////////////////////////////////
+int Enumerate (int k, int i, int *v, int record) {
+
+   int *p, j, d, partial, ways;
+
+   p = puzzle[k];
+
+   // All squares are filled. See if the region's target is hit.
+   if (i > p[0]) {
+      if (Evaluate (op[k], v, p[0]) != ans[k]) return 0;
+      if (record) {
+         nTuples[k] ++;
+         for (j = 1; j <= p[0]; j++) {
+            tuple[k][nTuples[k]][j] = v[j];
+         }
+      }
+      return 1;
+   }
+
+   ways = 0;
+   for (d = 1; d <= size; d++) {
+
+      // A digit cannot repeat within a row or column.
+      for (j = 1; j < i; j++) {
+         if (v[j] == d && ((p[j]-1) / size == (p[i]-1) / size
+                        || (p[j]-1) % size == (p[i]-1) % size)) break;
+      }
+      if (j < i) continue;
+
+      v[i] = d;
+
+      // Sums and products only grow, so stop early once they overshoot.
+      if (op[k] == '+' || op[k] == '*') {
+         partial = (op[k] == '+' ? 0 : 1);
+         for (j = 1; j <= i; j++) {
+            if (op[k] == '+') partial += v[j];
+            else              partial *= v[j];
+         }
+         if (op[k] == '+' && partial > ans[k]) break;
+         if (op[k] == '*' && ans[k] % partial != 0) continue;
+      }
+
+      ways += Enumerate (k, i+1, v, record);
+
+   }
+
+   return ways;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Is region k currently filled in one of the ways listed in tuple[k][*]?
+////////////////////////////////////////////////////////////////////////////////////
+int IsTuple (int k) {
+
+   int *p, i, j;
+
+   if (cageMiss[k]) return 0;
+
+   p = puzzle[k];
+   for (i = 2; i <= p[0]; i++) {
+      for (j = 1; j < i; j++) {
+         if (x1[p[j]] == x1[p[i]] && ((p[j]-1) / size == (p[i]-1) / size
+                                   || (p[j]-1) % size == (p[i]-1) % size)) return 0;
+      }
+   }
+
+   return 1;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Fill each region in a randomly chosen one of its listed ways.
+////////////////////////////////////////////////////////////////////////////////////
+void StartCages () {
+
+   int k, t, i;
+
+   for (k = 1; k <= puzzle[0][0]; k++) {
+      if (nTuples[k] > 0) {
+         t = RandomInteger (1, nTuples[k]);
+         for (i = 1; i <= puzzle[k][0]; i++) {
+            x1[puzzle[k][i]] = tuple[k][t][i];
+         }
+      }
+   }
+
+   return;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Make each row a random arrangement of the digits 1,...,size that puts every
+//    digit among its square's candidates.
+////////////////////////////////////////////////////////////////////////////////////
+void StartRows () {
+
+   int r;
+
+   for (r = 0; r < size; r++) {
+      if (!FillRow (r, 1, 0)) {
+         printf ("Row %d cannot be filled, so the puzzle has no solution.\n", r+1);
+         Quit (UNSOLVABLE);
+      }
+   }
+
+   return;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Fill squares c,...,size of row r with digits not in "used" (a bit mask),
+//    trying each square's candidates in random order and backing up when
+//    stuck. Returns 1 if this works, 0 if not.
+////////////////////////////////////////////////////////////////////////////////////
+int FillRow (int r, int c, int used) {
+
+   int k, d, j, n, list[10];
+
+   if (c > size) return 1;
+
+   k = r*size + c;
+   n = 0;
+   for (d = 1; d <= size; d++) {
+      if (cand[k] & ~used & (1 << d)) {
+         n ++;
+         list[n] = d;
+      }
+   }
+
+   while (n > 0) {
+      j = RandomInteger (1, n);
+      d = list[j];
+      list[j] = list[n];
+      n --;
+      x1[k] = d;
+      if (FillRow (r, c+1, used | (1 << d))) return 1;
+   }
+
+   return 0;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Narrow down the digits each square can hold before the chain starts:
+//    (1) a digit pinned to one square is ruled out for the rest of its row
+//        and column;
+//    (2) a way of filling a region that uses a ruled-out digit is dropped
+//        from the region's list, and a digit no remaining way puts in a
+//        square is ruled out for it;
+//    (3) a digit with only one possible square in a row or column goes there.
+// Repeat until nothing changes. Then list the squares left open.
+// Returns the number of squares pinned down, or -1 if some square has no
+//    digit left, in which case the puzzle has no solution.
+////////////////////////////////////////////////////////////////////////////////////
+int Presolve () {
+
+   int k, j, g, t, i, d, r, c, m, u, n, last, changed, fixed, *p, *w;
+   int seen[82];
+
+   for (k = 1; k <= size*size; k++) {
+      cand[k] = (1 << (size+1)) - 2;
+   }
+
+   do {
+
+      changed = 0;
+
+      // (1) Pinned digits.
+      for (k = 1; k <= size*size; k++) {
+         if (cand[k] & (cand[k] - 1)) continue;
+         r = (k-1) / size;
+         c = (k-1) % size + 1;
+         for (j = 1; j <= size; j++) {
+            m = r*size + j;
+            if (m != k && (cand[m] & cand[k])) {
+               cand[m] &= ~cand[k];
+               changed = 1;
+            }
+            m = (j-1)*size + c;
+            if (m != k && (cand[m] & cand[k])) {
+               cand[m] &= ~cand[k];
+               changed = 1;
+            }
+         }
+      }
+
+      // (2) Regions. Ways still possible are moved to the front of the list.
+      for (g = 1; g <= puzzle[0][0]; g++) {
+         p = puzzle[g];
+         for (i = 1; i <= p[0]; i++) {
+            seen[i] = 0;
+         }
+         m = 0;
+         for (t = 1; t <= nTuples[g]; t++) {
+            for (i = 1; i <= p[0]; i++) {
+               if (!(cand[p[i]] & (1 << tuple[g][t][i]))) break;
+            }
+            if (i <= p[0]) continue;
+            m ++;
+            w = tuple[g][t];
+            tuple[g][t] = tuple[g][m];
+            tuple[g][m] = w;
+            for (i = 1; i <= p[0]; i++) {
+               seen[i] |= 1 << tuple[g][m][i];
+            }
+         }
+         if (m < nTuples[g]) {
+            nTuples[g] = m;
+            changed = 1;
+         }
+         for (i = 1; i <= p[0]; i++) {
+            if (cand[p[i]] & ~seen[i]) {
+               cand[p[i]] &= seen[i];
+               changed = 1;
+            }
+         }
+      }
 
-   int i, k;
+      // (3) Digits with one place left in a row (u = 0) or column (u = 1).
+      for (u = 0; u <= 1; u++) {
+         for (r = 0; r < size; r++) {
+            for (d = 1; d <= size; d++) {
+               n = last = 0;
+               for (j = 1; j <= size; j++) {
+                  k = (u == 0) ? r*size + j : (j-1)*size + r + 1;
+                  if (cand[k] & (1 << d)) {
+                     n ++;
+                     last = k;
+                  }
+               }
+               if (n == 0) return -1;
+               if (n == 1 && cand[last] != (1 << d)) {
+                  cand[last] = 1 << d;
+                  changed = 1;
+               }
+            }
+         }
+      }
 
-   // Allocate the digits {1,2,3,4,5,6,7} in equal number (7 each) to the grid sites.
-   x1[0] = -1;
-   for (k = 0; k < 49; k++) {
-      i = 0;
-      // Pick a random unoccupied grid site.
-      while (x1[i] != 0) {
-         i = RandomInteger (1, 49);
+      for (k = 1; k <= size*size; k++) {
+         if (cand[k] == 0) return -1;
       }
-      // Assign it a digit so that all seven digits are present in equal number.
-      x1[i] = (k%7) + 1;
+
+   } while (changed);
+
+   // List the open squares, overall and by row.
+   nFree = 0;
+   for (r = 0; r < size; r++) {
+      rowFree[r][0] = 0;
    }
+   for (k = 1; k <= size*size; k++) {
+      if (cand[k] & (cand[k] - 1)) {
+         nFree ++;
+         freeSq[nFree] = k;
+         r = (k-1) / size;
+         rowFree[r][0] ++;
+         rowFree[r][rowFree[r][0]] = k;
+      }
+   }
+   fixed = size*size - nFree;
+
+   return fixed;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Propose a cage move: pick a region G0 at random and rewrite it in one of
+//    its listed ways, chosen at random. Returns the change in energy.
+// From y back to x the move has the same probability as from x to y, 1 over
+//    the number of regions times the number of ways, provided x's digits in
+//    region G0 are also one of the listed ways. If they are not, the reverse
+//    move is impossible, so the Hastings ratio is 0 and the proposal is
+//    rejected: the configuration is left unchanged.
+////////////////////////////////////////////////////////////////////////////////////
+int CageProposal () {
+
+   int *p, i, t, deltaE;
+
+   G0 = RandomInteger (1, puzzle[0][0]);
+   if (nTuples[G0] == 0 || !IsTuple (G0)) {
+      G0 = 0;
+      I0 = I1 = 1;
+      return 0;
+   }
+
+   p = puzzle[G0];
+   t = RandomInteger (1, nTuples[G0]);
+   deltaE = 0;
+   for (i = 1; i <= p[0]; i++) {
+      saved[i] = x1[p[i]];
+      deltaE += SetSquare (p[i], tuple[G0][t][i]);
+   }
+
+   return deltaE;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Construct initial random configuration.
+// Each row is a random arrangement of the digits {1,2,...,size}, so all digits
+//    are present in equal number (size each), with every square holding one
+//    of its candidates.
+////////////////////////////////////////////////////////////////////////////////////
+void Initialize () {
+
+   StartRows ();
+
 }
 
 ////////////////////////////////////////////////////////////////////////////////////
-// This function reads in the 7x7 puzzle's regions and numerical clues.
+// This function asks for the puzzle file and reads in the puzzle's size,
+//    regions and numerical clues.
 ////////////////////////////////////////////////////////////////////////////////////
 void GetPuzzle () {
 
-   int i, j, k, n, r, m, *p;
-   char input[100], *input0;
+   int i;
+   char input[100];
    FILE *fp=NULL;
 
-   printf ("I'll solve any 7x7 KenKen puzzle for you.\n\n");
+   printf ("I'll solve any KenKen puzzle up to 9x9 for you.\n\n");
 
    while (fp == NULL) {
 
@@ -354,15 +961,64 @@ void GetPuzzle () {
 
    }   
 
-   // Read in the regions.
+   ReadPuzzle (fp);
+
+   return;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Stop because the puzzle cannot be read or has no solution. A batch worker
+//    exits at once with the given status, for its parent to report; otherwise
+//    the user is asked to hit Enter first, as usual.
+////////////////////////////////////////////////////////////////////////////////////
+void Quit (int status) {
+
+#ifndef _WIN32
+   if (worker) _exit (status);
+#endif
+   Exit ();
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Read the puzzle in from the file fp, narrow down each square's candidates,
+//    and construct a random initial configuration.
+////////////////////////////////////////////////////////////////////////////////////
+void ReadPuzzle (FILE *fp) {
+
+   int i, j, k, n, r, m, *p, label[256];
+   char input[100], *input0;
+
+   // Read in the regions. The length of the first line is the puzzle's size.
+   // Any character can label a region. Regions are numbered 1, 2, 3, ... in
+   //    the order their labels first appear; label[c] is the number of the
+   //    region labeled c, or 0 if there is none.
    // n holds the number of regions.
+   for (i = 0; i < 256; i++) {
+      label[i] = 0;
+   }
+   if (fgets (input, 99, fp) == NULL) input[0] = '\0';
+   size = strcspn (input, " \r\n");
+   if (size < 1 || size > 9) {
+      printf ("The puzzle must be between 1x1 and 9x9.\n");
+      Quit (UNREADABLE);
+   }
    n = k = 0;
-   for (i = 1; i <= 7; i++) {
-      fgets (input, 99, fp);
-      for (j = 0; j < 7; j++) {
+   for (i = 1; i <= size; i++) {
+      if (i > 1 && fgets (input, 99, fp) == NULL) input[0] = '\0';
+      if ((int) strcspn (input, " \r\n") != size) {
+         printf ("Row %d of the puzzle should have %d labels.\n", i, size);
+         Quit (UNREADABLE);
+      }
+      for (j = 0; j < size; j++) {
          k++; // Current grid site number.
-         r = input[j] - 'A' + 1;
-         if (r > n) n = r;
+         if (label[(unsigned char) input[j]] == 0) {
+            n ++;
+            label[(unsigned char) input[j]] = n;
+         }
+         r = label[(unsigned char) input[j]];
+         cage[k] = r;
          p = puzzle[r];
          p[0] ++;
          m = p[0];
@@ -373,16 +1029,36 @@ void GetPuzzle () {
    // Put the number of regions into puzzle[0][0].
    puzzle[0][0] = n;
 
-   // Now get the numerical clues -- one for each of the n regions.
+   // Now get the numerical clues -- one for each of the n regions, in any
+   //    order. Each begins with its region's label.
    for (i = 1; i <= n; i++) {
-      fgets (input, 99, fp);
-      op[i] = input[2];
+      if (fgets (input, 99, fp) == NULL) {
+         printf ("There are clues for only %d of the %d regions.\n", i-1, n);
+         Quit (UNREADABLE);
+      }
+      r = label[(unsigned char) input[0]];
+      if (r == 0) {
+         printf ("There is no region %c for the clue %s", input[0], input);
+         Quit (UNREADABLE);
+      }
+      op[r] = input[2];
       input0 = input+3;
-      sscanf (input0, "%d", ans+i);
+      sscanf (input0, "%d", ans+r);
    }
 
    fclose (fp);
 
+   // List the ways of filling each region that hit its target.
+   CageTuples ();
+
+   // Narrow down each square's candidates.
+   n = Presolve ();
+   if (n < 0) {
+      printf ("\nConstraint propagation shows the puzzle has no solution.\n");
+      Quit (UNSOLVABLE);
+   }
+   printf ("\nConstraint propagation pinned down %d of the %d squares.\n", n, size*size);
+
    // Construct a random initial configuration.
    Initialize ();
 
@@ -391,161 +1067,332 @@ void GetPuzzle () {
 }
 
 ////////////////////////////////////////////////////////////////////////////////////
-// List the neighboring squares of each square.
+// Generate the output files for viewing, named with the given prefix:
+//    e.g., PuzzleGrid.txt, PuzzleRegions.txt and PuzzleSolution.txt.
+// One pass over the squares writes everything: the digit in square k; the
+//    boundary segments along its southern and eastern sides wherever the
+//    neighbor there is in another region (cage[] was filled in by
+//    GetPuzzle()); and, if k is the first square of its region, the clue.
 ////////////////////////////////////////////////////////////////////////////////////
-void Neighbors () {
+void Report (const char *prefix) {
+
+   int k, g;
+   double x, y;
+   char name[300];
+   FILE *fp, *fps;
 
-   int i, n;
+   // The grid, drawn to the size of the puzzle.
+   sprintf (name, "%sGrid.txt", prefix);
+   fp = fopen (name, "w");
+   fprintf (fp, "\\setplotarea x from 0 to %d, y from  0 to %d\n", size, size);
+   fprintf (fp, "\\setdashpattern <.02truein,.02truein>\n");
+   fprintf (fp, "\\setplotsymbol ({$\\scriptstyle\\cdot$})\n");
+   fprintf (fp, "\\grid %d %d\n", size, size);
+   fprintf (fp, "\\setsolid\\setplotsymbol ({$\\scriptscriptstyle\\bullet$})\n");
+   fprintf (fp, "\\plot 0 0  0 %d  %d %d  %d 0  0 0 /\n", size, size, size, size);
+   fclose (fp);
 
-   for (i = 1; i <= 49; i++) {
+   // Fully buffer both files so they are written in a few large blocks.
+   sprintf (name, "%sRegions.txt", prefix);
+   fp = fopen (name, "w");
+   sprintf (name, "%sSolution.txt", prefix);
+   fps = fopen (name, "w");
+   setvbuf (fp, NULL, _IOFBF, 1 << 16);
+   setvbuf (fps, NULL, _IOFBF, 1 << 16);
 
-      // Northern neighbor.
-      if (i > 7) {
-         // Northern.
-         N[i][0] ++;
-         n = N[i][0];
-         N[i][n] = i - 7;
-      }
+   // Loop through all the squares.
+   for (k = 1; k <= size*size; k++) {
+
+      // Compute the coordinates of square k's upper-left corner.
+      x = (k-1) % size;
+      y = size - (k-1) / size;
+      g = cage[k];
 
-      // Southern neighbor.
-      if (i < 49 - 7 + 1) {
-         N[i][0] ++;
-         n = N[i][0];
-         N[i][n] = i + 7;
+      fprintf (fps, "\\put {\\bf %d} at %f %f\n", x1[k], x+0.5, y-0.5);
+
+      // Southern side.
+      if (k + size <= size*size && cage[k+size] != g) {
+         fprintf (fp, "\\plot %f %f  %f %f /\n", x, y-1, x+1, y-1);
       }
 
-      // Eastern neighbor.
-      if (i % 7 != 0) {
-         N[i][0] ++;
-         n = N[i][0];
-         N[i][n] = i + 1;
+      // Eastern side.
+      if (k % size != 0 && cage[k+1] != g) {
+         fprintf (fp, "\\plot %f %f  %f %f /\n", x+1, y, x+1, y-1);
       }
 
-      // Western neighbor.
-      if (i % 7 != 1) {
-         N[i][0] ++;
-         n = N[i][0];
-         N[i][n] = i - 1;
+      // The clue goes in the region's first square.
+      if (puzzle[g][1] == k) {
+         if (op[g] == '+' || op[g] == '-') {
+            fprintf (fp, "\\put {$\\scriptscriptstyle %c$} [cr] at %f %f\n", op[g], x+.9, y-.17);
+         }
+         else if (op[g] == '/') {
+            fprintf (fp, "\\put {$\\scriptscriptstyle \\div$} [cr] at %f %f\n", x+.9, y-.17);
+         }
+         else {
+            fprintf (fp, "\\put {$\\scriptscriptstyle \\times$} [cr] at %f %f\n", x+.9, y-.17);
+         }
+         fprintf (fp, "\\put {$\\scriptscriptstyle %d$} [cl] at %f %f\n", ans[g], x+.1, y-.17);
       }
 
    }
 
+   fclose (fp);
+   fclose (fps);
+
    return;
 
 }
 
+#ifndef _WIN32
+
 ////////////////////////////////////////////////////////////////////////////////////
-// Which region is square k in?
+// Batch mode. Solve every puzzle named on the command line, and every puzzle
+//    file (ending in .txt) in the directories named there, several at a time.
+// Each puzzle is solved in its own worker process, with its own random
+//    numbers and chain, and its output files are named after it: the files
+//    for daily/Monday.txt are MondayGrid.txt, MondayRegions.txt and
+//    MondaySolution.txt, in the current directory. If two puzzles have the
+//    same name, the later one's files get a number as well (see
+//    OutputNames ()).
+// At the end a table of the steps and seconds each puzzle took is printed.
 ////////////////////////////////////////////////////////////////////////////////////
-int Region (int k) {
+void Batch (int argc, char *argv[]) {
+
+   int i, n, m, p, w, workers, seed, running, next, status, *pid, *job, *out,
+       *failed, *nSteps;
+   double *secs;
+   char **file, **prefix, answer[100];
+   int fd[2];
+
+   // List the puzzle files, first counting them.
+   n = 0;
+   for (i = 1; i < argc; i++) {
+      n += AddPuzzles (argv[i], NULL, 0);
+   }
+   if (n == 0) {
+      printf ("I found no puzzle files to solve.\n");
+      return;
+   }
+   file = (char **) calloc (n + 1, sizeof (char *));
+   n = 0;
+   for (i = 1; i < argc; i++) {
+      n += AddPuzzles (argv[i], file, n);
+   }
+
+   printf ("I'll solve %d KenKen puzzles for you.\n", n);
+   prefix = OutputNames (file, n);
+
+   // The same parameters are used for every puzzle.
+   GetParameters ();
+   workers = GetInteger ("\nHow many puzzles should be solved at once?... ");
+   if (workers < 1) workers = 1;
+
+   // Puzzle number i seeds its Mersenne Twister with seed + i - 1.
+   seed = GetInteger ("\nPlease seed the Mersenne Twister with a positive integer... ");
+
+   pid    = (int *) calloc (workers + 2, sizeof (int));
+   job    = (int *) calloc (workers + 1, sizeof (int));
+   out    = (int *) calloc (n + 1, sizeof (int));
+   failed = (int *) calloc (n + 1, sizeof (int));
+   nSteps = (int *) calloc (n + 1, sizeof (int));
+   secs   = (double *) calloc (n + 1, sizeof (double));
+
+   printf ("\n");
+   fflush (stdout);
+
+   // Keep up to "workers" puzzles going until all are done. Worker w is
+   //    process pid[w], solving puzzle number job[w].
+   running = 0;
+   next = 1;
+   while (next <= n || running > 0) {
+
+      // Start puzzles while there are free workers. A puzzle counts as failed
+      //    until its worker reports on it.
+      while (next <= n && running < workers) {
+         for (w = 1; pid[w] != 0; w++);
+         failed[next] = 1;
+         if (pipe (fd) != 0) {
+            printf ("I cannot start a worker for %s.\n", file[next]);
+            Exit ();
+         }
+         pid[w] = fork ();
+         if (pid[w] == 0) {
+            close (fd[0]);
+            Solve (fd[1], file[next], prefix[next], seed + next - 1);
+         }
+         close (fd[1]);
+         if (pid[w] < 0) {
+            printf ("I cannot start a worker for %s.\n", file[next]);
+            close (fd[0]);
+            pid[w] = 0;
+            next ++;
+            continue;
+         }
+         out[next] = fd[0];
+         job[w] = next;
+         running ++;
+         next ++;
+      }
+      if (running == 0) continue;
+
+      // Wait for one to finish, then read its steps and seconds. A worker
+      //    that stops without sending them, or with a nonzero exit status,
+      //    could not solve its puzzle; failed[i] keeps the status UNREADABLE
+      //    or UNSOLVABLE if it says why.
+      p = wait (&status);
+      if (p < 0) break;
+      for (w = 1; w <= workers && pid[w] != p; w++);
+      if (w > workers) continue;
+      i = job[w];
+      m = read (out[i], answer, sizeof (answer) - 1);
+      answer[m > 0 ? m : 0] = '\0';
+      if (WIFEXITED (status) && WEXITSTATUS (status) == 0
+                             && sscanf (answer, "%d %lf", nSteps+i, secs+i) == 2) {
+         failed[i] = 0;
+      }
+      else if (WIFEXITED (status) && (WEXITSTATUS (status) == UNREADABLE
+                                   || WEXITSTATUS (status) == UNSOLVABLE)) {
+         failed[i] = WEXITSTATUS (status);
+      }
+      close (out[i]);
+      pid[w] = 0;
+      running --;
 
-   int n, i, j, *p;
+   }
 
-   n = puzzle[0][0];
+   // Print the summary table.
+   printf ("    Steps     Seconds  Puzzle\n");
+   printf ("=========  ==========  ======\n");
    for (i = 1; i <= n; i++) {
-      p = puzzle[i];
-      for (j = 1; j <= p[0]; j++) {
-         if (p[j] == k) return i;
+      if (failed[i] == UNREADABLE) {
+         printf ("unreadable             %s\n", file[i]);
+      } else if (failed[i] == UNSOLVABLE) {
+         printf ("no solution            %s\n", file[i]);
+      } else if (failed[i]) {
+         printf ("   failed              %s\n", file[i]);
+      } else {
+         printf ("%9d  %10.2f  %s\n", nSteps[i], secs[i], file[i]);
       }
    }
 
-   printf ("Could not find which region square %d is in.\n", k);
-   Exit();
-
-   return 0;
+   return;
 
 }
 
 ////////////////////////////////////////////////////////////////////////////////////
-// Generate the output files for viewing.
+// Add the puzzle file "name", or each puzzle file in directory "name", to the
+//    list file[n+1], file[n+2], .... If "file" is NULL they are only counted.
+// Returns how many were added. In a directory the output files of an earlier
+//    batch are skipped.
 ////////////////////////////////////////////////////////////////////////////////////
-void Report () {
-
-   int k, n, m;
-   double x, y;
-   FILE *fp, *fps;
-
-   Neighbors ();
+int AddPuzzles (char *name, char **file, int n) {
 
-   fp = fopen ("PuzzleRegions.txt", "w");
-   fps = fopen ("PuzzleSolution.txt", "w");
+   int m, k;
+   DIR *dir;
+   struct dirent *entry;
+   struct stat info;
+   char path[1000], *e;
 
-   // Loop through all the squares.
-   for (k = 1; k <= 49; k++) {
+   if (stat (name, &info) != 0) {
+      if (file == NULL) printf ("There is no file or directory %s.\n", name);
+      return 0;
+   }
 
-      // Compute the coordinates of square k's upper-left corner.
-      x = (k-1) % 7;
-      y = 7 - (k-1) / 7;
+   if (!S_ISDIR (info.st_mode)) {
+      if (file != NULL) file[n+1] = strdup (name);
+      return 1;
+   }
 
-      fprintf (fps, "\\put {\\bf %d} at %f %f\n", x1[k], x+0.5, y-0.5);
+   dir = opendir (name);
+   if (dir == NULL) return 0;
+   m = 0;
+   while ((entry = readdir (dir)) != NULL) {
+      e = entry->d_name;
+      k = strlen (e);
+      if (k < 5 || strcmp (e + k - 4, ".txt") != 0) continue;
+      if ((k > 8  && strcmp (e + k - 8,  "Grid.txt") == 0)
+       || (k > 11 && strcmp (e + k - 11, "Regions.txt") == 0)
+       || (k > 12 && strcmp (e + k - 12, "Solution.txt") == 0)) continue;
+      m ++;
+      if (file != NULL) {
+         sprintf (path, "%s/%s", name, e);
+         file[n+m] = strdup (path);
+      }
+   }
+   closedir (dir);
 
-      // Loop through all neighboring squares of k.
-      for (n = 1; n <= N[k][0]; n++) {
+   return m;
 
-         // Square m is a neighbor of k.
-         m = N[k][n];
+}
 
-         // If k and m are in different regions draw a boundary segment.
-         if (Region(k) != Region(m)) {
+////////////////////////////////////////////////////////////////////////////////////
+// Choose the names the output files of puzzles file[1],...,file[n] begin
+//    with: the file name without its directory or ".txt". Puzzles with the
+//    same file name in different directories would overwrite each other's
+//    output, so a later one gets "_2", "_3", ... added until its name is new.
+////////////////////////////////////////////////////////////////////////////////////
+char **OutputNames (char **file, int n) {
 
-            // Is m k's northern, southern, eastern or western neighbor.
-            if (m == k - 7) {
-               fprintf (fp, "\\plot %f %f  %f %f /\n", x, y, x+1, y);
-            }
-            else if (m == k + 7) {
-               fprintf (fp, "\\plot %f %f  %f %f /\n", x, y-1, x+1, y-1);
-            }
-            else if (m == k + 1) {
-               fprintf (fp, "\\plot %f %f  %f %f /\n", x+1, y, x+1, y-1);
-            }
-            else if (m == k - 1) {
-               fprintf (fp, "\\plot %f %f  %f %f /\n", x, y, x, y-1);
-            }
+   int i, j, k, copy;
+   char **prefix, base[300], *b;
 
+   prefix = (char **) calloc (n + 1, sizeof (char *));
+   for (i = 1; i <= n; i++) {
+      prefix[i] = (char *) calloc (300, sizeof (char));
+      b = strrchr (file[i], '/');
+      strncpy (base, b ? b+1 : file[i], 250);
+      base[250] = '\0';
+      k = strlen (base);
+      if (k > 4 && strcmp (base + k - 4, ".txt") == 0) base[k-4] = '\0';
+      strcpy (prefix[i], base);
+      copy = 1;
+      for (j = 1; j < i; j++) {
+         if (strcmp (prefix[i], prefix[j]) == 0) {
+            copy ++;
+            sprintf (prefix[i], "%s_%d", base, copy);
+            j = 0;
          }
-
       }
-
+      if (copy > 1) {
+         printf ("The output files for %s will begin with %s.\n", file[i], prefix[i]);
+      }
    }
 
-   // Loop through the regions.
-   for (n = 1; n <= puzzle[0][0]; n++) {
+   return prefix;
 
-      for (k = 1; k <= 49; k++) {
-
-         if (Region (k) == n) {
-
-            // Compute the coordinates of square k's upper-left corner.
-            x = (k-1) % 7;
-            y = 7 - (k-1) / 7;
-            if (op[n] == '+' || op[n] == '-') {
-               fprintf (fp, "\\put {$\\scriptscriptstyle %c$} [cr] at %f %f\n", op[n], x+.9, y-.17);
-            }
-            else if (op[n] == '/') {
-               fprintf (fp, "\\put {$\\scriptscriptstyle \\div$} [cr] at %f %f\n", x+.9, y-.17);
-            }
-            else {
-               fprintf (fp, "\\put {$\\scriptscriptstyle \\times$} [cr] at %f %f\n", x+.9, y-.17);
-            }
-            fprintf (fp, "\\put {$\\scriptscriptstyle %d$} [cl] at %f %f\n", ans[n], x+.1, y-.17);
-            break;
+}
 
-         }
+////////////////////////////////////////////////////////////////////////////////////
+// A worker process: seed the RNG, solve the puzzle in "name", write its output
+//    files, named with "prefix", and send the steps and seconds the chain took
+//    through the pipe "out".
+////////////////////////////////////////////////////////////////////////////////////
+void Solve (int out, char *name, char *prefix, int seed) {
 
-      }
+   char answer[100];
+   FILE *fp;
 
-   }   
+   // Give every puzzle its own stream of random numbers. The progress reports
+   //    are discarded.
+   MTSeed (seed);
+   freopen ("/dev/null", "w", stdout);
+   worker = 1;
 
-      
-   fclose (fp);
-   fclose (fps);
+   fp = fopen (name, "r");
+   if (fp == NULL) _exit (UNREADABLE);
+   ReadPuzzle (fp);
+   Metropolis ();
+   Report (prefix);
 
-   printf ("View the puzzle and solution using plain TeX with KK.tex.\n");
-   Exit();
+   sprintf (answer, "%d %.2f\n", steps, seconds);
+   write (out, answer, strlen (answer));
 
+   _exit (0);
 
 }
 
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////
 // Allocate array space.
 ////////////////////////////////////////////////////////////////////////////////
@@ -553,16 +1400,34 @@ void AllocateMemory () {
 
    int i;
 
-   prob = (double *) calloc (11, sizeof (double));
-   x1 = (int *) calloc (50, sizeof (int));
-   N = (int **) calloc (50, sizeof (int *));
-   puzzle = (int **) calloc (50, sizeof (int *));
-   for (i = 0; i <= 49; i++) {
-      puzzle[i] = (int *) calloc (50, sizeof (int));
-      N[i] = (int *) calloc (9, sizeof (int));
+   // The puzzle's size is not known yet, so allocate enough for a 9x9 puzzle:
+   //    81 squares and at most 81 regions.
+   x1 = (int *) calloc (82, sizeof (int));
+   puzzle = (int **) calloc (82, sizeof (int *));
+   for (i = 0; i <= 81; i++) {
+      puzzle[i] = (int *) calloc (82, sizeof (int));
+   }
+   ans = (int *) calloc (82, sizeof (int));
+   op  = (char *) calloc (82, sizeof (char));
+   prob = (double *) calloc (326, sizeof (double));
+
+   cage     = (int *) calloc (82, sizeof (int));
+   cageSum  = (int *) calloc (82, sizeof (int));
+   cageProd = (int *) calloc (82, sizeof (int));
+   cageMiss = (int *) calloc (82, sizeof (int));
+   tuple    = (int ***) calloc (82, sizeof (int **));
+   nTuples  = (int *) calloc (82, sizeof (int));
+   saved    = (int *) calloc (82, sizeof (int));
+   cand     = (int *) calloc (82, sizeof (int));
+   freeSq   = (int *) calloc (82, sizeof (int));
+   rowFree  = (int **) calloc (10, sizeof (int *));
+   rowCount = (int **) calloc (10, sizeof (int *));
+   colCount = (int **) calloc (10, sizeof (int *));
+   for (i = 0; i <= 9; i++) {
+      rowCount[i] = (int *) calloc (10, sizeof (int));
+      colCount[i] = (int *) calloc (10, sizeof (int));
+      rowFree[i]  = (int *) calloc (10, sizeof (int));
    }
-   ans = (int *) calloc (50, sizeof (int));
-   op  = (char *) calloc (50, sizeof (char));
 
 }
 
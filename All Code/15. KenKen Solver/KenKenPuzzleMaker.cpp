@@ -0,0 +1,893 @@
+/*
+MIT License
+
+Copyright (c) 2024 CDouglasHoward13
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+////////////////////////////////////////////////////////////////////////////////
+// KenKen puzzle maker. This program creates a random KenKen puzzle with a
+// unique solution and writes it in the format read by KenKen.cpp (see
+// Puzzle1.txt). It works in four steps:
+// (1) a random Latin square is found via Metropolis, as in SudokuPuzzleMaker;
+// (2) the square is cut into random regions of neighboring squares;
+// (3) each region gets an operation, and its target is computed from the
+//     Latin square;
+// (4) an exact solver checks that the puzzle has only one solution.
+// Candidates with more than one solution are thrown away and the steps are
+// repeated. Several worker processes can look for a puzzle at once; the first
+// one to find a puzzle with a unique solution wins.
+////////////////////////////////////////////////////////////////////////////////
+
+// Global variables. The puzzle is size x size; squares are numbered
+//    1,...,size*size row by row, as in KenKen.cpp.
+int size,
+    *x1,         // The Latin square, i.e., the solution of the puzzle.
+    **puzzle,    // puzzle[k][i] is region k's i^th square, puzzle[k][0] its
+                 //    number of squares; puzzle[0][0] is the number of regions.
+    *cage,       // cage[k] is the region containing square k.
+    *ans,        // ans[k] is region k's target.
+    ***tuple,    // tuple[k][t][i] is the digit in region k's i^th square in
+                 //    the t^th way of filling region k that hits its target.
+    *nTuples,    // The number of such ways for region k.
+    full;        // Bit d is set for each digit d = 1,...,size.
+char *op;        // op[k] is region k's operation.
+
+// Characters used to label the regions in the puzzle file.
+const char *labels = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz"
+                     "0123456789#$%&*+-/<=>?@[]^_{|}~!";
+
+// Functions found below.
+void AllocateMemory ();
+int  MakePuzzle ();
+void LatinSquare ();
+void Regions ();
+void Operations ();
+void CageTuples ();
+int  Enumerate (int, int, int *, int);
+int  Evaluate (char, int *, int);
+int  CountSolutions (int *, int *, int *);
+int  Propagate (int *, int *, int *, int *);
+int  Place (int *, int *, int *, int, int);
+int  Bits (int);
+int  Compose (char *, int);
+void Save (char *);
+
+// These functions are in common among all metropolis applications.
+#include "MetropolisFunctions.h"
+
+// These are POSIX functions for running worker processes.
+#ifndef _WIN32
+#include <unistd.h>
+#include <signal.h>
+#include <poll.h>
+#include <sys/wait.h>
+
+int  Workers (int);
+void Worker (int, int);
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// Main program.
+////////////////////////////////////////////////////////////////////////////////
+int main () {
+
+   int tries, workers;
+   char message[4096];
+
+   printf ("I will generate a random KenKen puzzle with a unique solution.\n\n");
+
+   size = 0;
+   while (size < 3 || size > 9) {
+      size = GetInteger ("How big should the puzzle be (3 to 9)?... ");
+   }
+   full = (1 << (size+1)) - 2;
+
+   // Allocate array space.
+   AllocateMemory ();
+
+#ifndef _WIN32
+   workers = GetInteger ("\nHow many worker processes should look for puzzles?... ");
+   if (workers > 1) {
+      tries = Workers (workers);
+      printf ("\nA puzzle with a unique solution was found after %d candidates.\n", tries);
+      Exit ();
+   }
+#endif
+
+   // Look for a puzzle in this process.
+   MTUniform ();
+   Time ();
+   tries = 1;
+   while (!MakePuzzle ()) {
+      tries ++;
+   }
+   Compose (message, tries);
+   Save (message);
+   printf ("\nA puzzle with a unique solution was found after %d candidates in %.1f seconds.\n",
+              tries, Time ());
+
+   Exit ();
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Make one candidate puzzle. Returns 1 if it has a unique solution, 0 if not.
+////////////////////////////////////////////////////////////////////////////////
+int MakePuzzle () {
+
+   int k, v[82], row[10], col[10];
+
+   // (1)
+   LatinSquare ();
+
+   // (2)
+   Regions ();
+
+   // (3)
+   Operations ();
+   CageTuples ();
+
+   // (4)
+   // Start the solver from an empty grid.
+   for (k = 1; k <= size*size; k++) {
+      v[k] = 0;
+   }
+   for (k = 1; k <= size; k++) {
+      row[k] = col[k] = 0;
+   }
+
+   return (CountSolutions (v, row, col) == 1);
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Find a random Latin square x1[*] via Metropolis. Each row is always an
+//    arrangement of the digits 1,...,size; a proposal swaps two squares in a
+//    row, and the energy counts how far the columns are from holding each
+//    digit once.
+////////////////////////////////////////////////////////////////////////////////
+void LatinSquare () {
+
+   int r, c, c0, c1, j, k0, k1, a, b, E, deltaE, temp, count[10][10];
+   double prob[9];
+
+   // Acceptance probabilities at temperature 0.3. A swap changes the energy
+   //    by at most 8.
+   for (deltaE = 1; deltaE <= 8; deltaE++) {
+      prob[deltaE] = exp (-deltaE/0.3);
+   }
+
+   // Random rows.
+   for (r = 0; r < size; r++) {
+      for (c = 1; c <= size; c++) {
+         x1[r*size+c] = c;
+      }
+      for (c = 1; c < size; c++) {
+         j = RandomInteger (c, size);
+         temp = x1[r*size+c];
+         x1[r*size+c] = x1[r*size+j];
+         x1[r*size+j] = temp;
+      }
+   }
+
+   // Count the digits in each column and compute the energy.
+   for (c = 1; c <= size; c++) {
+      for (a = 1; a <= size; a++) {
+         count[c][a] = 0;
+      }
+      for (r = 0; r < size; r++) {
+         count[c][x1[r*size+c]] ++;
+      }
+   }
+   E = 0;
+   for (c = 1; c <= size; c++) {
+      for (a = 1; a <= size; a++) {
+         E += abs (count[c][a] - 1);
+      }
+   }
+
+   while (E > 0) {
+
+      // Swap the digits a and b in columns c0 and c1 of a random row.
+      r  = RandomInteger (0, size-1);
+      c0 = RandomInteger (1, size);
+      c1 = c0;
+      while (c1 == c0) {
+         c1 = RandomInteger (1, size);
+      }
+      k0 = r*size + c0;
+      k1 = r*size + c1;
+      a = x1[k0];
+      b = x1[k1];
+
+      // Column c0 loses an a and gains a b; column c1 the reverse.
+      deltaE = abs (count[c0][a] - 2) - abs (count[c0][a] - 1)
+             + abs (count[c0][b])     - abs (count[c0][b] - 1)
+             + abs (count[c1][b] - 2) - abs (count[c1][b] - 1)
+             + abs (count[c1][a])     - abs (count[c1][a] - 1);
+
+      if (deltaE <= 0 || MTUniform () <= prob[deltaE]) {
+         x1[k0] = b;
+         x1[k1] = a;
+         count[c0][a] --; count[c0][b] ++;
+         count[c1][b] --; count[c1][a] ++;
+         E += deltaE;
+      }
+
+   }
+
+   return;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Cut the square into regions. Squares are visited in random order; each one
+//    not yet in a region starts a new region, which grows into random
+//    neighboring free squares until it reaches a randomly chosen size from 1
+//    to 4 (2 and 3 being most common), or cannot grow any more.
+////////////////////////////////////////////////////////////////////////////////
+void Regions () {
+
+   int i, j, k, m, n, s, *p, order[82], free[82], nFree, r, c;
+   double U;
+
+   for (k = 1; k <= size*size; k++) {
+      cage[k] = 0;
+      order[k] = k;
+   }
+   for (k = 1; k < size*size; k++) {
+      j = RandomInteger (k, size*size);
+      m = order[k];
+      order[k] = order[j];
+      order[j] = m;
+   }
+
+   n = 0;
+   for (i = 1; i <= size*size; i++) {
+
+      k = order[i];
+      if (cage[k]) continue;
+
+      // Start region n with square k.
+      n ++;
+      p = puzzle[n];
+      p[0] = 1;
+      p[1] = k;
+      cage[k] = n;
+
+      // Its intended size.
+      U = MTUniform ();
+      s = (U < 0.10 ? 1 : U < 0.55 ? 2 : U < 0.85 ? 3 : 4);
+
+      while (p[0] < s) {
+
+         // List the free squares next to the region.
+         nFree = 0;
+         for (j = 1; j <= p[0]; j++) {
+            r = (p[j]-1) / size;
+            c = (p[j]-1) % size;
+            if (r > 0      && !cage[p[j]-size]) free[++nFree] = p[j] - size;
+            if (r < size-1 && !cage[p[j]+size]) free[++nFree] = p[j] + size;
+            if (c > 0      && !cage[p[j]-1])    free[++nFree] = p[j] - 1;
+            if (c < size-1 && !cage[p[j]+1])    free[++nFree] = p[j] + 1;
+         }
+         if (nFree == 0) break;
+
+         // Add one of them at random.
+         m = free[RandomInteger (1, nFree)];
+         p[0] ++;
+         p[p[0]] = m;
+         cage[m] = n;
+
+      }
+
+   }
+
+   puzzle[0][0] = n;
+
+   return;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Choose each region's operation and compute its target from the Latin square.
+// A single square gets "+" (its target is its digit). Two squares get "/" if
+// one digit divides the other (half the time), otherwise "-", "+", or "*".
+// Larger regions get "+" or "*".
+////////////////////////////////////////////////////////////////////////////////
+void Operations () {
+
+   int k, i, *p, v[82], a, b;
+   double U;
+
+   for (k = 1; k <= puzzle[0][0]; k++) {
+
+      p = puzzle[k];
+      for (i = 1; i <= p[0]; i++) {
+         v[i] = x1[p[i]];
+      }
+
+      U = MTUniform ();
+      if (p[0] == 1) {
+         op[k] = '+';
+      }
+      else if (p[0] == 2) {
+         a = (v[1] > v[2] ? v[1] : v[2]);
+         b = (v[1] > v[2] ? v[2] : v[1]);
+         if (a % b == 0 && U < 0.5) op[k] = '/';
+         else if (U < 0.8)          op[k] = '-';
+         else if (U < 0.9)          op[k] = '+';
+         else                       op[k] = '*';
+      }
+      else {
+         op[k] = (U < 0.5 ? '+' : '*');
+      }
+
+      ans[k] = Evaluate (op[k], v, p[0]);
+
+   }
+
+   return;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// For each region, list every way of filling its squares with digits that
+//    hits the region's target and repeats no digit within a row or column.
+////////////////////////////////////////////////////////////////////////////////
+void CageTuples () {
+
+   int k, t, v[82];
+
+   for (k = 1; k <= puzzle[0][0]; k++) {
+
+      // Free the lists from the previous candidate.
+      if (tuple[k] != NULL) {
+         for (t = 1; t <= nTuples[k]; t++) {
+            free (tuple[k][t]);
+         }
+         free (tuple[k]);
+      }
+
+      // First count the ways, then allocate space and record them.
+      nTuples[k] = Enumerate (k, 1, v, 0);
+      tuple[k] = (int **) calloc (nTuples[k] + 1, sizeof (int *));
+      for (t = 1; t <= nTuples[k]; t++) {
+         tuple[k][t] = (int *) calloc (puzzle[k][0] + 1, sizeof (int));
+      }
+      nTuples[k] = 0;
+      Enumerate (k, 1, v, 1);
+
+   }
+
+   return;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Try every digit in the i^th square of region k, given the digits v[1],...,
+//    v[i-1] already placed in its earlier squares. Returns how many ways of
+//    filling the rest of the region work. If "record" is 1, each way found is
+//    also added to the list tuple[k][*]. (As in KenKen.cpp.)
+////////////////////////////////////////////////////////////////////////////////
+int Enumerate (int k, int i, int *v, int record) {
+
+   int *p, j, d, partial, ways;
+
+   p = puzzle[k];
+
+   // All squares are filled. See if the region's target is hit.
+   if (i > p[0]) {
+      if (Evaluate (op[k], v, p[0]) != ans[k]) return 0;
+      if (record) {
+         nTuples[k] ++;
+         for (j = 1; j <= p[0]; j++) {
+            tuple[k][nTuples[k]][j] = v[j];
+         }
+      }
+      return 1;
+   }
+
+   ways = 0;
+   for (d = 1; d <= size; d++) {
+
+      // A digit cannot repeat within a row or column.
+      for (j = 1; j < i; j++) {
+         if (v[j] == d && ((p[j]-1) / size == (p[i]-1) / size
+                        || (p[j]-1) % size == (p[i]-1) % size)) break;
+      }
+      if (j < i) continue;
+
+      v[i] = d;
+
+      // Sums and products only grow, so stop early once they overshoot.
+      if (op[k] == '+' || op[k] == '*') {
+         partial = (op[k] == '+' ? 0 : 1);
+         for (j = 1; j <= i; j++) {
+            if (op[k] == '+') partial += v[j];
+            else              partial *= v[j];
+         }
+         if (op[k] == '+' && partial > ans[k]) break;
+         if (op[k] == '*' && ans[k] % partial != 0) continue;
+      }
+
+      ways += Enumerate (k, i+1, v, record);
+
+   }
+
+   return ways;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Perform operation o on the n digits v[1],...,v[n]. (As in KenKen.cpp.)
+////////////////////////////////////////////////////////////////////////////////
+int Evaluate (char o, int *v, int n) {
+
+   int i, answer = -1;
+
+   if (o == '+') {
+      answer = 0;
+      for (i = 1; i <= n; i++) {
+         answer += v[i];
+      }
+   }
+
+   else if (o == '-') {
+      answer = abs (v[1] - v[2]);
+   }
+
+   else if (o == '*') {
+      answer = 1;
+      for (i = 1; i <= n; i++) {
+         answer *= v[i];
+      }
+   }
+
+   else if (o == '/') {
+      if (v[1] % v[2] == 0) {
+         answer = v[1] / v[2];
+      } else if (v[2] % v[1] == 0) {
+         answer = v[2] / v[1];
+      }
+   }
+
+   return answer;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The exact solver. Count the solutions of the puzzle that agree with the
+//    digits already placed in v[*] (0 for an empty square); row[r] and col[c]
+//    have bit d set if digit d is already used in row r or column c.
+// Counting stops at 2, since that is enough to know the solution is not unique.
+// The arrays are changed, so callers pass copies.
+////////////////////////////////////////////////////////////////////////////////
+int CountSolutions (int *v, int *row, int *col) {
+
+   int k, best, d, count, allowed[82], v1[82], row1[10], col1[10];
+
+   // Place every digit that is forced; give up if there is a contradiction.
+   if (!Propagate (v, row, col, allowed)) return 0;
+
+   // Branch on the empty square with the fewest possible digits.
+   best = 0;
+   for (k = 1; k <= size*size; k++) {
+      if (v[k] == 0 && (best == 0 || Bits (allowed[k]) < Bits (allowed[best]))) {
+         best = k;
+      }
+   }
+
+   // No empty squares: this is a solution.
+   if (best == 0) return 1;
+
+   count = 0;
+   for (d = 1; d <= size && count < 2; d++) {
+      if (allowed[best] & (1 << d)) {
+         memcpy (v1, v, sizeof (v1));
+         memcpy (row1, row, sizeof (row1));
+         memcpy (col1, col, sizeof (col1));
+         if (Place (v1, row1, col1, best, d)) {
+            count += CountSolutions (v1, row1, col1);
+         }
+      }
+   }
+
+   return count;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Constraint propagation. The digits allowed in each square (as a bit mask)
+//    are those not yet used in its row or column and that appear in that
+//    square in some way of filling its region that agrees with what is placed
+//    so far. A square with only one allowed digit gets it, as does the only
+//    square in a row or column where some digit is allowed. This is repeated
+//    until nothing more is forced. Returns 0 on a contradiction, 1 otherwise.
+////////////////////////////////////////////////////////////////////////////////
+int Propagate (int *v, int *row, int *col, int *allowed) {
+
+   int k, g, t, i, r, c, d, *p, ok, changed, where, count, seen[10];
+
+   changed = 1;
+   while (changed) {
+
+      changed = 0;
+
+      // Digits allowed by rows and columns.
+      for (k = 1; k <= size*size; k++) {
+         r = (k-1) / size + 1;
+         c = (k-1) % size + 1;
+         allowed[k] = (v[k] ? 1 << v[k] : full & ~row[r] & ~col[c]);
+      }
+
+      // Digits allowed by regions.
+      for (g = 1; g <= puzzle[0][0]; g++) {
+         p = puzzle[g];
+         for (i = 1; i <= p[0]; i++) {
+            seen[i] = 0;
+         }
+         for (t = 1; t <= nTuples[g]; t++) {
+            ok = 1;
+            for (i = 1; i <= p[0] && ok; i++) {
+               ok = allowed[p[i]] & (1 << tuple[g][t][i]);
+            }
+            if (ok) {
+               for (i = 1; i <= p[0]; i++) {
+                  seen[i] |= 1 << tuple[g][t][i];
+               }
+            }
+         }
+         for (i = 1; i <= p[0]; i++) {
+            allowed[p[i]] &= seen[i];
+         }
+      }
+
+      // Squares with one allowed digit.
+      for (k = 1; k <= size*size; k++) {
+         if (allowed[k] == 0) return 0;
+         if (v[k] == 0 && Bits (allowed[k]) == 1) {
+            for (d = 1; !(allowed[k] & (1 << d)); d++);
+            if (!Place (v, row, col, k, d)) return 0;
+            changed = 1;
+         }
+      }
+      if (changed) continue;
+
+      // Digits with one place to go in a row or column.
+      for (r = 1; r <= size; r++) {
+         for (d = 1; d <= size; d++) {
+
+            // Row r.
+            if (!(row[r] & (1 << d))) {
+               count = 0;
+               for (c = 1; c <= size; c++) {
+                  k = (r-1)*size + c;
+                  if (v[k] == 0 && (allowed[k] & (1 << d))) {
+                     count ++;
+                     where = k;
+                  }
+               }
+               if (count == 0) return 0;
+               if (count == 1) {
+                  if (!Place (v, row, col, where, d)) return 0;
+                  changed = 1;
+               }
+            }
+
+            // Column r.
+            if (!(col[r] & (1 << d))) {
+               count = 0;
+               for (c = 1; c <= size; c++) {
+                  k = (c-1)*size + r;
+                  if (v[k] == 0 && (allowed[k] & (1 << d))) {
+                     count ++;
+                     where = k;
+                  }
+               }
+               if (count == 0) return 0;
+               if (count == 1) {
+                  if (!Place (v, row, col, where, d)) return 0;
+                  changed = 1;
+               }
+            }
+
+         }
+      }
+
+   }
+
+   return 1;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Place digit d in empty square k. Returns 0 if d is already used in that
+//    row or column, 1 otherwise.
+////////////////////////////////////////////////////////////////////////////////
+int Place (int *v, int *row, int *col, int k, int d) {
+
+   int r, c;
+
+   r = (k-1) / size + 1;
+   c = (k-1) % size + 1;
+   if ((row[r] | col[c]) & (1 << d)) return 0;
+
+   v[k] = d;
+   row[r] |= 1 << d;
+   col[c] |= 1 << d;
+
+   return 1;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The number of bits set in m.
+////////////////////////////////////////////////////////////////////////////////
+int Bits (int m) {
+
+   int n = 0;
+
+   while (m) {
+      m &= m - 1;
+      n ++;
+   }
+
+   return n;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Write the puzzle into "message": the number of candidates tried, then the
+//    puzzle in the format of Puzzle1.txt, then a line "=" followed by the
+//    solution. Returns the length of the message.
+////////////////////////////////////////////////////////////////////////////////
+int Compose (char *message, int tries) {
+
+   int r, c, k, n;
+
+   n = sprintf (message, "%d\n", tries);
+
+   // The regions, one row per line.
+   for (r = 0; r < size; r++) {
+      for (c = 1; c <= size; c++) {
+         message[n++] = labels[cage[r*size+c]-1];
+      }
+      message[n++] = '\n';
+   }
+
+   // The clues, one per region.
+   for (k = 1; k <= puzzle[0][0]; k++) {
+      n += sprintf (message+n, "%c %c %d\n", labels[k-1], op[k], ans[k]);
+   }
+
+   // The solution.
+   n += sprintf (message+n, "=\n");
+   for (r = 0; r < size; r++) {
+      for (c = 1; c <= size; c++) {
+         message[n++] = '0' + x1[r*size+c];
+      }
+      message[n++] = '\n';
+   }
+   message[n] = '\0';
+
+   return n;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Save the puzzle in "message" (see Compose ()) to a file named by the user,
+//    and show the puzzle and its solution on the screen.
+////////////////////////////////////////////////////////////////////////////////
+void Save (char *message) {
+
+   int i;
+   char input[100], *puzzleText, *solution;
+   FILE *fp = NULL;
+
+   // Split the message into its parts.
+   puzzleText = strchr (message, '\n') + 1;
+   solution = strstr (puzzleText, "=\n");
+   *solution = '\0';
+   solution += 2;
+
+   printf ("\nHere is the puzzle:\n\n%s\nand its solution:\n\n%s", puzzleText, solution);
+
+   while (fp == NULL) {
+
+      printf ("\nPlease input the name of the file for the puzzle... ");
+      fgets (input, 99, stdin);
+
+      // Now terminate the file name with ".txt", as in KenKen.cpp.
+      for (i = 1; i <= 20; i++) {
+         if (input[i] == '\n' || input[i] == '.') {
+            input[i] = '.';
+            input[i+1] = 't';
+            input[i+2] = 'x';
+            input[i+3] = 't';
+            input[i+4] = '\0';
+            break;
+         }
+      }
+
+      fp = fopen (input, "w");
+
+   }
+
+   fprintf (fp, "%s", puzzleText);
+   fclose (fp);
+
+   printf ("Solve it with KenKen.cpp.\n");
+
+   return;
+
+}
+
+#ifndef _WIN32
+
+////////////////////////////////////////////////////////////////////////////////
+// Look for a puzzle with "workers" worker processes. Each one sends its puzzle
+//    back through its own pipe; the first to arrive is saved and the other
+//    workers are stopped. Returns the total number of candidates tried by the
+//    successful worker.
+////////////////////////////////////////////////////////////////////////////////
+int Workers (int workers) {
+
+   int w, i, k, n, seed, tries, running, *pid;
+   char message[4096];
+   struct pollfd *pipes;
+   int fd[2];
+
+   // Worker number w seeds its Mersenne Twister with seed + w - 1.
+   seed = GetInteger ("\nPlease seed the Mersenne Twister with a positive integer... ");
+
+   pid = (int *) calloc (workers + 1, sizeof (int));
+   pipes = (struct pollfd *) calloc (workers + 1, sizeof (struct pollfd));
+
+   // A worker that could not be started has pid 0 and a negative fd, which
+   //    poll () ignores.
+   running = 0;
+   fflush (stdout);
+   for (w = 1; w <= workers; w++) {
+      if (pipe (fd) != 0) {
+         printf ("I cannot start worker %d.\n", w);
+         Exit ();
+      }
+      pid[w] = fork ();
+      if (pid[w] == 0) {
+         close (fd[0]);
+         Worker (fd[1], seed + w - 1);
+      }
+      close (fd[1]);
+      pipes[w].fd = fd[0];
+      pipes[w].events = POLLIN;
+      if (pid[w] < 0) {
+         printf ("I cannot start worker %d.\n", w);
+         close (fd[0]);
+         pid[w] = 0;
+         pipes[w].fd = -1;
+      }
+      else {
+         running ++;
+      }
+   }
+
+   printf ("\nI'm looking for a puzzle with %d workers. ", workers);
+   fflush (stdout);
+
+   // Wait for the first worker with something to say. A pipe that is closed
+   //    (POLLHUP) or broken (POLLERR) with nothing in it belongs to a worker
+   //    that died, so stop polling it.
+   n = 0;
+   w = 0;
+   while (w == 0 && running > 0) {
+      if (poll (pipes+1, workers, -1) < 0) continue;
+      for (i = 1; i <= workers && w == 0; i++) {
+         if (pipes[i].revents & POLLIN) {
+            w = i;
+         }
+         else if (pipes[i].revents & (POLLHUP | POLLERR | POLLNVAL)) {
+            close (pipes[i].fd);
+            pipes[i].fd = -1;
+            running --;
+         }
+      }
+   }
+
+   // Read its message, up to and including the terminating '\0'.
+   if (w > 0) {
+      while (n == 0 || message[n-1] != '\0') {
+         k = read (pipes[w].fd, message+n, sizeof (message) - n);
+         if (k <= 0) break;
+         n += k;
+      }
+   }
+
+   // Stop all the workers.
+   for (i = 1; i <= workers; i++) {
+      if (pid[i] > 0) kill (pid[i], SIGTERM);
+      if (pipes[i].fd >= 0) close (pipes[i].fd);
+   }
+   while (wait (NULL) > 0);
+
+   if (w == 0) {
+      printf ("\nEvery worker stopped without finding a puzzle.\n");
+      Exit ();
+   }
+   if (n == 0 || message[n-1] != '\0') {
+      printf ("\nWorker %d sent back an incomplete puzzle (%d bytes).\n", w, n);
+      Exit ();
+   }
+
+   sscanf (message, "%d", &tries);
+   Save (message);
+
+   return tries;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// A worker process: seed the RNG, look for a puzzle with a unique solution,
+//    and send it (see Compose ()) through the pipe "out", including the
+//    terminating '\0'.
+////////////////////////////////////////////////////////////////////////////////
+void Worker (int out, int seed) {
+
+   int tries, n;
+   char message[4096];
+
+   // Give every worker its own stream of random numbers.
+   MTSeed (seed);
+   freopen ("/dev/null", "w", stdout);
+
+   tries = 1;
+   while (!MakePuzzle ()) {
+      tries ++;
+   }
+
+   n = Compose (message, tries);
+   write (out, message, n + 1);
+
+   _exit (0);
+
+}
+
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// Allocate array space, enough for a 9x9 puzzle.
+////////////////////////////////////////////////////////////////////////////////
+void AllocateMemory () {
+
+   int i;
+
+   x1      = (int *) calloc (82, sizeof (int));
+   cage    = (int *) calloc (82, sizeof (int));
+   ans     = (int *) calloc (82, sizeof (int));
+   op      = (char *) calloc (82, sizeof (char));
+   nTuples = (int *) calloc (82, sizeof (int));
+   tuple   = (int ***) calloc (82, sizeof (int **));
+   puzzle  = (int **) calloc (82, sizeof (int *));
+   for (i = 0; i <= 81; i++) {
+      puzzle[i] = (int *) calloc (82, sizeof (int));
+   }
+
+}
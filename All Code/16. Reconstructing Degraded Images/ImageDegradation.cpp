@@ -23,98 +23,219 @@ SOFTWARE.
 */
 
 ////////////////////////////////////////////////////////////////////////////////
-// This program creates an image and degrades it for a specified number of
-// years as described in Section 16.
-// Output files OriginalImagePixels.txt and DegradedImagePixels.txt are created.
-// DegradedImagePixels.txt is the data input for ImageReconstruction.cpp.
+// This program creates an image, or reads one from a PBM or PGM file, and
+// degrades it for a specified number of years as described in Section 16.
+// Output files OriginalImage.pbm and DegradedImage.pbm are created, and for
+// images up to 200 x 200 also OriginalImagePixels.txt and
+// DegradedImagePixels.txt for viewing with ShowImageDegradation.tex.
+// Gray-scale images go to OriginalImage.pgm and DegradedImage.pgm instead.
+// DegradedImage.pbm (or .pgm) is the data input for ImageReconstruction.cpp.
 ////////////////////////////////////////////////////////////////////////////////
 
 // These functions are found below.
-void AllocateImageMemory ();
 void MakeImage (int);
 void ReportImage (int, int);
+void Flip (int, int);
 
 // These functions are common to all applications.
 #include "MetropolisFunctions.h"
 
-// The image is a global variable.
-int **x;
+// These functions store, read, and write images.
+#include "ImageFunctions.h"
+
+// The image is a global variable, packed 64 pixels to a word as described in
+//    ImageFunctions.h.
+unsigned long long *x;
+
+// A gray-scale image has q gray levels, 0 (black) to q-1 (white), and is kept
+//    in "g" a byte per pixel, as described in ImageFunctions.h. For black and
+//    white images q is 2 and "g" is not used.
+int q = 2;
+unsigned char *g;
 
 ////////////////////////////////////////////////////////////////////////////////
 // Main program.
 ////////////////////////////////////////////////////////////////////////////////
 int main() {
 
-   int i, j, n, t, which;
-
-   // Allocate array space for the images.
-   AllocateImageMemory ();
+   int i, j, n, which, type, maxval, white;
+   long long r, k, N;
+   double t, flips, p, skip;
+   char input[100], comment[100];
+   unsigned char *gray;
+   FILE *fp = NULL;
 
    // Get information from the user.
    printf ("I will randomly degrade an image for you.\n\n");
-   which = GetInteger ("Which image should I use: bull's eye (1) or smiley face (2)?... ");
+   which = GetInteger ("Which image should I use: bull's eye (1), smiley face (2),\n"
+                       "or a PBM or PGM file (3)?... ");
+
+   // Read in the image...
+   if (which == 3) {
+      while (fp == NULL) {
+         printf ("\nPlease input the name of the PBM or PGM file... ");
+         fgets (input, 99, stdin);
+         input[strcspn (input, "\r\n")] = '\0';
+         fp = OpenImage (input, &type, &maxval, comment);
+      }
+      if (type == 4) {
+         x = ReadPBM (fp);
+      }
+
+      // A gray-scale image is put in q gray levels, or made black and white
+      //    if q is 2: pixels darker than middle gray are black.
+      else {
+         gray = ReadPGM (fp, maxval);
+         white = (maxval < 256 ? maxval : maxval >> 8);
+         q = GetInteger ("\nHow many gray levels should the image have (2 for black and white,"
+                         "\nup to 256)?... ");
+         if (q > 256) q = 256;
+         if (q > 2) {
+            g = gray;
+            for (i = 1; i <= W; i++) {
+               for (j = 1; j <= H; j++) {
+                  r = (long long) (H-j)*(W+2) + i-1;
+                  g[r] = (g[r] * (q-1) + white/2) / white;
+               }
+            }
+         } else {
+            q = 2;
+            x = AllocateImage ();
+            for (i = 1; i <= W; i++) {
+               for (j = 1; j <= H; j++) {
+                  if (2*gray[(long long) (H-j)*(W+2) + i-1] < white) FlipPixel (x, i, j);
+               }
+            }
+         }
+      }
+   }
+
+   // ... or make the desired image, at the desired size.
+   else {
+      i = GetInteger ("\nHow many pixels wide should the image be (200 in the book)?... ");
+      j = GetInteger ("\nHow many pixels high should the image be (200 in the book)?... ");
+      SetImageSize (i, j);
+      x = AllocateImage ();
+      MakeImage (which);
+   }
+
    n = GetInteger ("\nHow many years of degradation should I do (100 <= years <= 2000)?... ");
    MTUniform(); // Seed the RNG.
 
-   // Made the desired image.
-   MakeImage (which);
-
    // Report the undegraded image.
    ReportImage (which, n);
 
-   // Degrade the image over time, flipping 40 pixels per year.
-   for (t = 1; t <= 40*n; t++) {
+   // Degrade the image over time, flipping 1 pixel in 1000 per year (40 per
+   //    year in a 200 x 200 image).
+   N = (long long) W * H;
+   flips = N / 1000.0 * n;
+
+   // Only whether a pixel ends up flipped matters: in a black and white image,
+   //    whether it is flipped an odd number of times. Each pixel ends up
+   //    flipped with chance p, as computed in ImageReconstruction.cpp, so
+   //    images bigger than the book's 200 x 200 are degraded by picking those
+   //    pixels directly, which takes time in proportion to their number
+   //    rather than to the number of flips. Going through the pixels in
+   //    order, the number passed over before the next one picked is
+   //    geometric: the whole part of log(U) / log(1-p), for U uniform on (0,1).
+   if (N > 40000) {
+      p = (q-1.0)/q * (1.0 - pow (1.0 - q/((q-1.0)*N), flips));
+      k = -1;
+      while (1) {
+         skip = log (MTUniform ()) / log1p (-p);
+         if (k + 1 + skip >= N) break;
+         k += 1 + (long long) skip;
+         Flip (k % W + 1, H - k / W);
+      }
+      flips = 0;
+   }
 
-      i = RandomInteger (1, 200);
-      j = RandomInteger (1, 200);
+   for (t = 1; t <= flips; t++) {
+
+      i = RandomInteger (1, W);
+      j = RandomInteger (1, H);
 
       // Flip the pixel at (i,j).
-      x[i][j] = 1 - x[i][j];
+      Flip (i, j);
 
    }
 
    // Report the degraded image.
    ReportImage (which, n);
 
-   printf ("\nView the image degradation with ShowImageDegredation.tex using Plain TeX.\n");
+   if (q > 2) {
+      printf ("\nThe images are in OriginalImage.pgm and DegradedImage.pgm.\n");
+   } else {
+      printf ("\nThe images are in OriginalImage.pbm and DegradedImage.pbm.\n");
+   }
+   if (q == 2 && W <= 200 && H <= 200) {
+      printf ("View the image degradation with ShowImageDegradation.tex using Plain TeX.\n");
+   }
 
    Pause ();
 
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// Report the current state of the image.
+// Report the current state of the image: first the original image, then the
+//    degraded one. The number of years of degradation goes in the comment
+//    line of DegradedImage.pbm, where ImageReconstruction.cpp looks for it.
 ////////////////////////////////////////////////////////////////////////////////
 void ReportImage (int which, int n) {
 
    int i, j;
    static int k = 0;
+   char comment[100];
    FILE *fp;
 
-   // Report the original or degraded image black pixels.
-   if (k == 0) {
-      fp = fopen ("OriginalImagePixels.txt", "w");
-      if (which == 1) {
-         fprintf (fp, "%% Bull's eye image undegraded.\n");
+   if (which == 1) {
+      sprintf (comment, "Bull's eye image undegraded.");
+   } else if (which == 2) {
+      sprintf (comment, "Smiley face image undegraded.");
+   } else {
+      sprintf (comment, "Image undegraded.");
+   }
+
+   // Report the original or degraded image: a gray-scale image to a PGM file
+   //    with its gray levels, 0 to q-1.
+   if (q > 2) {
+      if (k == 0) {
+         WritePGM ("OriginalImage.pgm", g, q-1, comment);
       } else {
-         fprintf (fp, "%% Smiley face image undegraded.\n");
+         sprintf (comment, "%d Years of degradation.", n);
+         WritePGM ("DegradedImage.pgm", g, q-1, comment);
       }
+      k = 1;
+      return;
    }
 
-   else {
-      fp = fopen ("DegradedImagePixels.txt", "w");
-      fprintf (fp, "%% %d Years of degradation.\n", n);
+   if (k == 0) {
+      WritePBM ("OriginalImage.pbm", x, comment);
+   } else {
+      sprintf (comment, "%d Years of degradation.", n);
+      WritePBM ("DegradedImage.pbm", x, comment);
    }
 
+   // For images that fit, also list the black pixels for ShowImageDegradation.tex.
+   if (W <= 200 && H <= 200) {
 
-   for (i = 1; i <= 200; i++) {
-      for (j = 1; j <= 200; j++) {
-         if (x[i][j]) {
-            fprintf (fp, "%d  %d\n", i, j);
+      if (k == 0) {
+         fp = fopen ("OriginalImagePixels.txt", "w");
+      } else {
+         fp = fopen ("DegradedImagePixels.txt", "w");
+      }
+      fprintf (fp, "%% %s\n", comment);
+
+      for (i = 1; i <= W; i++) {
+         for (j = 1; j <= H; j++) {
+            if (Pixel (x, i, j)) {
+               fprintf (fp, "%d  %d\n", i, j);
+            }
          }
       }
+      fclose (fp);
+
    }
-   fclose (fp);
 
    k = 1;
 
@@ -123,30 +244,56 @@ void ReportImage (int which, int n) {
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// Generate the desired image and put it in the "x[i][j]" array. ///////////////
+// Flip the pixel at (i,j): in a gray-scale image, give it one of the other
+//    gray levels at random.
+////////////////////////////////////////////////////////////////////////////////
+void Flip (int i, int j) {
+
+   int level;
+   long long r;
+
+   if (q > 2) {
+      r = (long long) (H-j)*(W+2) + i-1;
+      level = RandomInteger (0, q-2);
+      if (level >= g[r]) level ++;
+      g[r] = level;
+   } else {
+      FlipPixel (x, i, j);
+   }
+
+   return;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Generate the desired image and put it in the image "x". /////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 void MakeImage (int which) {
 
-   int i, j;
-   double x0, y0, d;
+   int i, j, black;
+   double x0, y0, d, m;
+
+   // Half the smaller of the width and height.
+   m = (W < H ? W : H) / 2.0;
 
-   // Make the selected image; x[i][j] = 1 if black, 0 if white.
-   for (i = 1; i <= 200; i++) {
-      for (j = 1; j <= 200; j++) {
+   // Make the selected image; pixel (i,j) is black if "black" is 1.
+   for (i = 1; i <= W; i++) {
+      for (j = 1; j <= H; j++) {
 
          // (x0,y0) are the coordinates of pixel (i,j).  They are scaled to
-         //   fall between -1 and +1.
-         x0 = (i-100) / 100.0;
-         y0 = (j-100) / 100.0;
+         //   fall between -1 and +1 across the smaller of the width and
+         //   height, with (0,0) in the middle.
+         x0 = (i - W/2.0) / m;
+         y0 = (j - H/2.0) / m;
 
          // Bull's eye.
          if (which == 1) {
             d = sqrt(x0*x0 + y0*y0);
             if (d <= .199 || (.4 <= d && d <= .599) || (.8 <= d && d <= .999) ) {
-               x[i][j] = 1;
+               black = 1;
             }
             else   {
-               x[i][j] = 0;
+               black = 0;
             }
          }
 
@@ -155,59 +302,33 @@ void MakeImage (int which) {
             d = sqrt(x0*x0 + y0*y0);
             // Circle around face:
             if (0.85 <= d && d <= 0.999) {
-               x[i][j] = 1;
+               black = 1;
             }
             // Right eye:
             else if (sqrt(pow(x0-.5,2) +pow(y0-0.25,2)) < .129) {
-               x[i][j] = 1;
+               black = 1;
             }
             // Left eye:
             else if (sqrt(pow(x0+.5,2) +pow(y0-0.25,2)) < .129) {
-               x[i][j] = 1;
+               black = 1;
             }
             //Smile:
             else if ( (sqrt(pow(x0,2) +pow(y0-(-0.10),2)) < .5) &&
                       (sqrt(pow(x0,2) +pow(y0-0.15,2)) > .499) &&
                       (y0 < -0.10)
                     ) {
-               x[i][j] = 1;
+               black = 1;
             }
             else   {
-               x[i][j] = 0;
+               black = 0;
             }
          }
 
+         if (black) FlipPixel (x, i, j);
+
       } // "j" loop.
    } // "i" loop.
 
    return;
 
 }
-
-////////////////////////////////////////////////////////////////////////////////
-// Allocate array space for the images /////////////////////////////////////////
-////////////////////////////////////////////////////////////////////////////////
-void AllocateImageMemory () {
-
-   // Allocate space for a 200 x 200 pixel image plus a white boundary (top,
-   //    bottom, left, and right).
-   // The white boundary is when i or j are 0 or 201. This is not part of the image.
-
-   int i;
-
-   x = (int **) calloc (202, sizeof (int));
-   for (i = 0; i <= 201; i++) {
-      x[i] = (int *) calloc (202, sizeof (int));
-   }
-
-   return;
-
-}
-
-
-
-
-
-
-
-
@@ -0,0 +1,369 @@
+/*
+MIT License
+
+Copyright (c) 2024 CDouglasHoward13
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// This file declares and defines the functions that store, read and write
+// images in ImageDegradation.cpp and ImageReconstruction.cpp. Include it
+// after MetropolisFunctions.h.
+//
+// Images may be any size, W pixels wide and H pixels high. Pixel (i,j) is i
+// pixels from the left and j pixels from the bottom, 1 <= i <= W, 1 <= j <= H.
+//
+// Black and white images are stored 64 pixels to a word ("packed"). Rows run
+// from the top of the image (row 0) down: pixel (i,j) is in row H-j, word
+// (i-1)/64, bit 63-(i-1)%64 (a 1 is black). Each row has an extra white word
+// at either end and there is an extra white row above and below, so every
+// pixel's neighbors can be read without checking for the edges of the image.
+// An image array points at word 0 of row 0; S words separate rows.
+//
+// Gray-scale images are stored a byte per pixel, in the same order: pixel
+// (i,j) is byte (H-j)*(W+2) + i-1, with an extra byte at either end of each
+// row and an extra row above and below.
+//
+// Images are read and written as binary PBM (black and white) and PGM (gray)
+// files, which most image programs can show and convert. A PBM file holds
+// each row as bits, 8 pixels to a byte with the leftmost pixel in the top bit,
+// which is the order of a packed row, so its rows are read straight into the
+// image's words.
+
+int W, H, S;
+
+// These functions are found below.
+void   SetImageSize (int, int);
+unsigned long long *AllocateImage (void);
+int    Pixel (unsigned long long *, int, int);
+void   FlipPixel (unsigned long long *, int, int);
+FILE  *OpenImage (const char *, int *, int *, char *);
+int    HeaderNumber (FILE *, char *);
+unsigned long long *ReadPBM (FILE *);
+unsigned long long GetWord (unsigned char *, int, long long);
+void   PutWord (unsigned char *, int, long long, unsigned long long);
+void   WritePBM (const char *, unsigned long long *, const char *);
+unsigned char *AllocateGrayImage (void);
+unsigned char *ReadPGM (FILE *, int);
+void   WritePGM (const char *, unsigned char *, int, const char *);
+
+////////////////////////////////////////////////////////////////////////////////
+// Set the size of the images to w x h pixels.
+////////////////////////////////////////////////////////////////////////////////
+void SetImageSize (int w, int h) {
+
+   W = w;
+   H = h;
+
+   // Words per row, with the extra word at either end.
+   S = (W + 63) / 64 + 2;
+
+   return;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Allocate one all-white W x H packed image with its white border, and return
+//    a pointer to word 0 of row 0.
+////////////////////////////////////////////////////////////////////////////////
+unsigned long long *AllocateImage () {
+
+   unsigned long long *image;
+
+   image = (unsigned long long *) calloc ((long long) (H+2) * S, sizeof (unsigned long long));
+   if (image == NULL) {
+      printf ("There is not enough memory for a %d x %d image.\n", W, H);
+      Exit ();
+   }
+
+   return image + S + 1;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The color of pixel (i,j): 1 if black, 0 if white. Pixels just outside the
+//    image (i = 0 or W+1, j = 0 or H+1) are white.
+////////////////////////////////////////////////////////////////////////////////
+int Pixel (unsigned long long *image, int i, int j) {
+
+   // Shift i up by 64 so the white word left of the image works out right.
+   i += 63;
+   return (image[(long long) (H-j)*S + i/64 - 1] >> (63 - i%64)) & 1;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Flip pixel (i,j) from black to white or white to black.
+////////////////////////////////////////////////////////////////////////////////
+void FlipPixel (unsigned long long *image, int i, int j) {
+
+   i += 63;
+   image[(long long) (H-j)*S + i/64 - 1] ^= 1ULL << (63 - i%64);
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Open the PBM or PGM file "name" and read its header. The image size is set
+//    from it, and the first comment line (without the '#') is put in
+//    "comment", which is left empty if there is none. *type is set to 4 for
+//    a PBM file and 5 for a PGM file, and *maxval to the number of the
+//    lightest gray (1 for PBM).
+// Returns the file, ready to read the pixels, or NULL if it cannot be read.
+////////////////////////////////////////////////////////////////////////////////
+FILE *OpenImage (const char *name, int *type, int *maxval, char *comment) {
+
+   FILE *fp;
+   int w, h;
+
+   comment[0] = '\0';
+
+   fp = fopen (name, "rb");
+   if (fp == NULL) return NULL;
+
+   // The "magic number": P4 for PBM, P5 for PGM.
+   if (fgetc (fp) != 'P') {
+      fclose (fp);
+      return NULL;
+   }
+   *type = fgetc (fp) - '0';
+   if (*type != 4 && *type != 5) {
+      fclose (fp);
+      return NULL;
+   }
+
+   w = HeaderNumber (fp, comment);
+   h = HeaderNumber (fp, comment);
+   *maxval = (*type == 5 ? HeaderNumber (fp, comment) : 1);
+   if (w < 1 || h < 1 || *maxval < 1 || *maxval > 65535) {
+      fclose (fp);
+      return NULL;
+   }
+
+   // A single white space character separates the header from the pixels;
+   //    HeaderNumber () has read it already.
+
+   SetImageSize (w, h);
+
+   return fp;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Read the next number in an image file header, skipping white space and
+//    comments, and the character after it. The first comment found is saved
+//    in "comment" if it is empty.
+////////////////////////////////////////////////////////////////////////////////
+int HeaderNumber (FILE *fp, char *comment) {
+
+   int c, n, k;
+
+   c = fgetc (fp);
+   while (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '#') {
+      if (c == '#') {
+         k = (comment[0] == '\0' ? 0 : -1);
+         while ((c = fgetc (fp)) != '\n' && c != EOF) {
+            if (k >= 0 && k < 99) comment[k++] = c;
+         }
+         if (k >= 0) comment[k] = '\0';
+      }
+      c = fgetc (fp);
+   }
+
+   n = 0;
+   while ('0' <= c && c <= '9') {
+      n = 10*n + (c - '0');
+      c = fgetc (fp);
+   }
+
+   return n;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Read the pixels of a PBM file opened by OpenImage () into a new packed
+//    image. Each row goes straight into its words, which are then put in
+//    the machine's byte order.
+////////////////////////////////////////////////////////////////////////////////
+unsigned long long *ReadPBM (FILE *fp) {
+
+   int r, w, bytes;
+   unsigned long long *image, *row;
+
+   image = AllocateImage ();
+   bytes = (W + 7) / 8;
+
+   for (r = 0; r < H; r++) {
+
+      row = image + (long long) r*S;
+      fread (row, 1, bytes, fp);
+
+      for (w = 0; w < S-2; w++) {
+         row[w] = GetWord ((unsigned char *) row, w, bytes);
+      }
+
+      // Bits past the right edge of the image are padding; make them white.
+      row[S-3] &= ~0ULL << (63 - (W-1) % 64);
+
+   }
+
+   fclose (fp);
+
+   return image;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Word w of a row of PBM pixels "row", which is "bytes" bytes long. Bytes past
+//    the end of the row count as white.
+////////////////////////////////////////////////////////////////////////////////
+unsigned long long GetWord (unsigned char *row, int w, long long bytes) {
+
+   int k;
+   unsigned long long word = 0;
+
+   for (k = 0; k < 8; k++) {
+      word = (word << 8) | (8LL*w + k < bytes ? row[8LL*w + k] : 0);
+   }
+
+   return word;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Put "word" in as word w of a row of PBM pixels "row", which is "bytes" bytes
+//    long. Bytes past the end of the row are left out.
+////////////////////////////////////////////////////////////////////////////////
+void PutWord (unsigned char *row, int w, long long bytes, unsigned long long word) {
+
+   int k;
+
+   for (k = 0; k < 8 && 8LL*w + k < bytes; k++) {
+      row[8LL*w + k] = (unsigned char) (word >> (56 - 8*k));
+   }
+
+   return;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Write packed image "image" to the PBM file "name", with a comment line.
+////////////////////////////////////////////////////////////////////////////////
+void WritePBM (const char *name, unsigned long long *image, const char *comment) {
+
+   int r, w;
+   unsigned long long *row;
+   unsigned char *bytes;
+   FILE *fp;
+
+   fp = fopen (name, "wb");
+   if (fp == NULL) {
+      printf ("I cannot write the image file %s.\n", name);
+      return;
+   }
+   fprintf (fp, "P4\n# %s\n%d %d\n", comment, W, H);
+
+   bytes = (unsigned char *) calloc (8 * (S-2), sizeof (unsigned char));
+   for (r = 0; r < H; r++) {
+      row = image + (long long) r*S;
+      for (w = 0; w < S-2; w++) {
+         PutWord (bytes, w, (W + 7) / 8, row[w]);
+      }
+      fwrite (bytes, 1, (W + 7) / 8, fp);
+   }
+   free (bytes);
+
+   fclose (fp);
+
+   return;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Allocate one W x H gray-scale image, every byte 0, and return a pointer to
+//    pixel (1,H), its top left corner.
+////////////////////////////////////////////////////////////////////////////////
+unsigned char *AllocateGrayImage () {
+
+   unsigned char *image;
+
+   image = (unsigned char *) calloc ((long long) (H+2) * (W+2), sizeof (unsigned char));
+   if (image == NULL) {
+      printf ("There is not enough memory for a %d x %d image.\n", W, H);
+      Exit ();
+   }
+
+   return image + (W+2) + 1;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Read the pixels of a PGM file opened by OpenImage () into a new gray-scale
+//    image. Each row goes straight into place. Files with more than 256 grays
+//    (two bytes a pixel) keep just the high byte of each pixel.
+////////////////////////////////////////////////////////////////////////////////
+unsigned char *ReadPGM (FILE *fp, int maxval) {
+
+   int r, i;
+   unsigned char *image, *row, pair[2];
+
+   image = AllocateGrayImage ();
+
+   for (r = 0; r < H; r++) {
+      row = image + (long long) r*(W+2);
+      if (maxval < 256) {
+         fread (row, 1, W, fp);
+      } else {
+         for (i = 0; i < W; i++) {
+            fread (pair, 1, 2, fp);
+            row[i] = pair[0];
+         }
+      }
+   }
+
+   fclose (fp);
+
+   return image;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Write gray-scale image "image", with grays 0 (black) to maxval (white), to
+//    the PGM file "name", with a comment line.
+////////////////////////////////////////////////////////////////////////////////
+void WritePGM (const char *name, unsigned char *image, int maxval, const char *comment) {
+
+   int r;
+   FILE *fp;
+
+   fp = fopen (name, "wb");
+   if (fp == NULL) {
+      printf ("I cannot write the image file %s.\n", name);
+      return;
+   }
+   fprintf (fp, "P5\n# %s\n%d %d\n%d\n", comment, W, H, maxval);
+
+   for (r = 0; r < H; r++) {
+      fwrite (image + (long long) r*(W+2), 1, W, fp);
+   }
+
+   fclose (fp);
+
+   return;
+
+}
@@ -25,36 +25,198 @@ SOFTWARE.
 ////////////////////////////////////////////////////////////////////////////////
 // This code uses the Metropolis algorithm to reconstruct an image
 //   that has been randomly degraded as described in Section 16.
+// Gray-scale images (PGM files) can be reconstructed in q gray levels.
+// The checkerboard sweeps run on several cores when compiled with OpenMP
+//   (e.g., g++ -O2 -fopenmp); otherwise they run on one.
+// Images too big to hold in memory are reconstructed a tile at a time
+//   straight from one file into another (see Tiled () below).
+// The ways of reconstructing can be compared on degraded copies of an
+//   original image (see Benchmark () below).
 
 ////////////////////////////////////////////////////////////////////////////////
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 // Image arrays are global variables so that the above functions have access.
-int **x,    // Degraded image, then reconstructed image.
-    **d,    // Degraded image
-    **best; // Lowest energy (best-found) image.
+// They are packed 64 pixels to a word, as described in ImageFunctions.h.
+unsigned long long *x,    // Degraded image, then reconstructed image.
+                   *d,    // Degraded image
+                   *best; // Lowest energy (best-found) image.
+
+// For gray-scale reconstruction there are q gray levels, 0 (black) to q-1
+//    (white), and the images are stored a byte per pixel as described in
+//    ImageFunctions.h, with the border around them white. For black and white
+//    images q is 2 and these are not used.
+int q = 2;
+unsigned char *gx, *gd, *gbest;
 
 // E_min and lambda are used in the functions Metropolis() and Energy ().
 double E_min, lambda;
 
+// For checkerboard sweeps: a random number stream for each row of pixels, and
+//    the acceptance thresholds Threshold[a][b] for a flip of a pixel that has b
+//    disagreeing neighbors and agrees (a = 1) or disagrees (a = 0) with the
+//    degraded image. A flip is accepted if a random 32-bit integer is below
+//    the threshold.
+unsigned long long *rng, Threshold[2][5];
+
+// Change[a][b] is the change in energy for such a flip.
+double Change[2][5];
+
+// For gray-scale images, when a pixel's level changes the number of its
+//    neighbors it differs from changes by b (-4 to 4) and whether it differs
+//    from the degraded image by a (-1 to 1). The change in energy is then
+//    GrayChange[b+4][a+1], and GrayThreshold[b+4][a+1] is the acceptance
+//    threshold for checkerboard sweeps.
+unsigned long long GrayThreshold[9][3];
+double GrayChange[9][3];
+
+// Checkerboard sweeps of gray-scale images handle the pixels of one color in
+//    a row GRAY_BLOCK at a time (see GraySweep ()).
+#define GRAY_BLOCK 32
+
+// The pixels flipped since "best" was last brought up to date, as pairs (i,j)
+//    (for gray-scale images, pairs of the pixel's place in the image and its
+//    new level), and how many of them lead to the lowest energy image. The journal holds
+//    up to journalSize flips; when it is full (journalLength = -1), "best" is
+//    brought up to date and copied whole at the next new lowest energy.
+int *journal, journalLength, bestLength, journalSize;
+
+// For tiled reconstruction: the pixels of the degraded image file and of the
+//    reconstruction file, mapped into memory, the number of bytes in a row of
+//    each, and the type (4 for PBM, 5 for PGM) and lightest gray of the first.
+unsigned char *inPixels, *outPixels;
+long long inRow, outRow;
+int inType, inMaxval;
+
+// For the graph cut: pixel p = r*W + i-1 is in row r, as in a packed image.
+//    cap[4*p+k] is the unused capacity of the link from p to its neighbor in
+//    direction k (up, down, left, right), and terminal[p] that of the link
+//    from the source to p if positive, from p to the sink if negative.
+//    tree[p] is the search tree p is in (SOURCE, SINK, or 0 for neither),
+//    parent[p] the direction of its parent (TERMINAL at the root of a tree,
+//    ORPHAN if it has lost its parent), and stamp[p] and dist[p] tell when
+//    p was last found to be dist[p] links from a terminal. Active pixels are
+//    kept in a list linked by nextActive[p] (-1 if p is not in the list, p
+//    at the end of it), orphans in the circular queue "orphans".
+#define SOURCE 1
+#define SINK 2
+#define TERMINAL 4
+#define ORPHAN -1
+double *cap, *terminal;
+int *parent, *stamp, *dist, *nextActive, *orphans, firstActive, lastActive,
+    firstOrphan, nOrphans, now;
+char *tree;
+
+// For flips of pixels picked mostly from the "active set": the pixels that
+//    differ from a neighbor, which are the only ones whose flips are often
+//    accepted. Pixel p = r*W + i-1 (in row r) is
+//    members[place[p]] if it is in the set, and place[p] is -1 if not; there
+//    are nMembers in all. A proposed pixel comes from the set with probability
+//    FOCUS and from the whole image otherwise.
+#define FOCUS 0.9
+int *members, *place, nMembers;
+
+// For cluster flips: pixel p = r*W + i-1 is in the cluster whose root is
+//    found by following cluster[p] (cluster[p] = p at a root). At a root,
+//    field[p] is how much more the cluster's pixels add to the energy when
+//    black than when white, and clusterColor[p] is the color it is given.
+int *cluster;
+double *field;
+char *clusterColor;
+
 // These functions are found below.
 void   AllocateImageMemory (void);
 void   ReportImage ();
-void   CopyImage (int **, int **);
+void   CopyImage (unsigned long long *, unsigned long long *);
+void   WriteCoordinates (const char *, unsigned long long *);
+void   CopyGray (unsigned char *, unsigned char *);
+double GrayEnergy (void);
+double GrayDeltaEnergy (int, int);
+void   GrayMetropolis (void);
+double GraySweep (void);
+void   Journal (int, int);
+void   NewBest (void);
+void   BestImage (void);
 double Energy (void);
 double DeltaEnergy (int, int);
-void   GetDegradedImage (void);
+void   GetDegradedImage (const char *);
+void   SetLambda (const char *);
 void   Metropolis (void);
+double Sweep (void);
+double SweepWord (unsigned long long *, unsigned long long, unsigned long long,
+                  unsigned long long *, int);
+void   Thresholds (double, int);
+double Pyramid (double);
+void   Tiled (const char *, const char *);
+double SweepTile (int, int, int, int, int, unsigned long long *);
+unsigned long long DegradedWord (int, int);
+void   ExactReconstruction (void);
+void   MarginalReconstruction (void);
+void   CountBlack (unsigned int *, unsigned long long *);
+void   Marginals (unsigned int *, int, unsigned char *);
+double GraphCut (void);
+void   MaxFlow (void);
+int    Neighbor (int, int);
+void   Augment (int, int, int);
+void   Adopt (int);
+void   SetActive (int);
+void   SetOrphan (int);
+int    Step (int, double, double *);
+double ClusterSweep (double);
+int    Root (int);
+void   Join (int, int);
+void   ActiveSet (void);
+void   UpdateActiveSet (int, int);
+int    Active (int, int);
+double Proposal (int, int);
+double HastingsRatio (int, int);
+double MostRatio (int, int);
+void   Benchmark (int, char **);
+void   Degrade (unsigned long long *, int);
+int    Differences (unsigned long long *, unsigned long long *);
+unsigned long long RandomBits (unsigned long long *);
+double WallTime (void);
 
 // These functions are common to all applications.
 #include "MetropolisFunctions.h"
 
+// These functions store, read, and write images.
+#include "ImageFunctions.h"
+
 /////////////////////////////////////////////////////////////////////////////////////////
 // Main program. ////////////////////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////////////////////////////////////
-int main() {
+int main (int argc, char *argv[]) {
+
+   // Given "-benchmark" and the names of original images (PBM files), e.g.
+   //    ImageReconstruction -benchmark OriginalImage.pbm
+   //    degrade them and compare the ways of reconstructing them.
+   if (argc > 1 && strcmp (argv[1], "-benchmark") == 0) {
+      Benchmark (argc-2, argv+2);
+   }
+
+   // Given two file names, e.g.
+   //    ImageReconstruction scan.pbm clean.pbm
+   //    reconstruct the first image into the second a tile at a time, for
+   //    images too big to hold in memory.
+   if (argc > 2) {
+      Tiled (argv[1], argv[2]);
+   }
 
    // Get the degraded image; put it in the "d" array and also the "best" array.
-   GetDegradedImage ();
+   // It is DegradedImage.pbm or DegradedImage.pgm, as made by
+   //    ImageDegradation.cpp, unless another PBM or PGM file is named on the
+   //    command line, e.g.
+   //    ImageReconstruction scan.pgm
+   GetDegradedImage (argc > 1 ? argv[1] : "DegradedImage.pbm");
 
    // Report the degraded image.
    ReportImage ();
@@ -65,54 +227,139 @@ int main() {
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////
-// This function reads in the degraded image.   /////////////////////////////////////////
+// This function reads in the degraded image from the PBM or PGM file "name". ///////////
+// A PGM file (e.g., a gray-scale scan) is reconstructed in q gray levels, the //////////
+// nearest of which each gray is put to, or if q is 2 is made black and white: //////////
+// pixels darker than middle gray are black. If there is no such file, the list /////////
+// of black pixels in DegradedImagePixels.txt (a 200 x 200 image) is read instead. //////
 /////////////////////////////////////////////////////////////////////////////////////////
-void GetDegradedImage () {
+void GetDegradedImage (const char *name) {
 
-   int i, j;
-   double t, p, q;
+   int i, j, type, maxval, white;
+   long long r;
    FILE *fp;
-   char input[100];
+   char input[100], comment[100], question[200];
+   unsigned char *gray;
 
+   fp = OpenImage (name, &type, &maxval, comment);
+   if (fp == NULL && strcmp (name, "DegradedImage.pbm") == 0) {
+      fp = OpenImage ("DegradedImage.pgm", &type, &maxval, comment);
+   }
 
-   // Allocate array space for image pixels.
-   AllocateImageMemory ();
+   if (fp != NULL && type == 4) {
+      d = ReadPBM (fp);
+   }
+
+   else if (fp != NULL) {
+      gray = ReadPGM (fp, maxval);
+      white = (maxval < 256 ? maxval : maxval >> 8);
+      sprintf (question, "\nHow many gray levels should the reconstruction have (2 for black and"
+                         "\nwhite, up to 256; this image has %d)?... ", white + 1);
+      q = GetInteger (question);
+      if (q > 256) q = 256;
+      if (q > 2) {
+         gd = AllocateGrayImage ();
+         memset (gd - (W+2) - 1, q-1, (long long) (H+2) * (W+2));
+         for (i = 1; i <= W; i++) {
+            for (j = 1; j <= H; j++) {
+               r = (long long) (H-j)*(W+2) + i-1;
+               gd[r] = (gray[r] * (q-1) + white/2) / white;
+            }
+         }
+      } else {
+         q = 2;
+         d = AllocateImage ();
+         for (i = 1; i <= W; i++) {
+            for (j = 1; j <= H; j++) {
+               r = (long long) (H-j)*(W+2) + i-1;
+               if (2*gray[r] < white) FlipPixel (d, i, j);
+            }
+         }
+      }
+      free (gray - (W+2) - 1);
+   }
+
+   else {
+
+      // Open the data file.
+      fp = fopen ("DegradedImagePixels.txt", "r");
+      if (fp == NULL) {
+         printf ("I cannot find the degraded image %s.\n", name);
+         Exit ();
+      }
+      SetImageSize (200, 200);
+      d = AllocateImage ();
+
+      // First line contains the years of degradation.
+      fgets (input, 99, fp);
+      sprintf (comment, "%s", input+2);
+
+      // Read in the blackened pixel coordinates in the degraded image.
+      while (1) {
+
+         if (fgets (input, 99, fp) == NULL) break;
+         sscanf (input, "%d %d", &i, &j);
+         if (!Pixel (d, i, j)) FlipPixel (d, i, j);
+
+      }
+
+      fclose (fp);
+
+   }
 
-   // Open the data file.
-   fp = fopen ("DegradedImagePixels.txt", "r");
+   // Allocate array space for the other images.
+   AllocateImageMemory ();
 
-   // First line contains the years of degradation.
-   fgets (input, 99, fp);
-   sscanf (input+2, "%lf", &t);
-   printf ("I'm reconstructing an image degraded %.0f years.\n", t);
+   // Compute lambda.
+   SetLambda (comment);
 
    // Seed the RNG.
    MTUniform ();
 
-   // Read in the blackened pixel coordinates in the degraded image.
-   while (1) {
+   // Start the Markov chain in the degraded state.
+   // Initially the degraded image itself is the best reconstruction so far.
+   if (q > 2) {
+      CopyGray (gd, gx);
+      CopyGray (gd, gbest);
+   } else {
+      CopyImage (d, x);
+      CopyImage (d, best);
+   }
 
-      if (fgets (input, 99, fp) == NULL) break;
-      sscanf (input, "%d %d", &i, &j);
-      d[i][j] = 1;
+}
 
-   }
+////////////////////////////////////////////////////////////////////////////////
+// Compute lambda for a W x H degraded image whose file comment is "comment".
+////////////////////////////////////////////////////////////////////////////////
+void SetLambda (const char *comment) {
+
+   double t, p, N;
 
    // Compute the probability "p" that any particular pixel is flipped
-   //    at "t" years and the related quantity "lambda".
-   p = 1.0/40000.0;
-   q = 1.0 - p;
-   p = (1.0 - pow(q-p, 40.0*t)) / 2.0;
+   //    at "t" years and the related quantity "lambda". Each year
+   //    N/1000 random pixels are flipped (40 in a 200 x 200 image), and p
+   //    is the chance that a given pixel is flipped an odd number of times.
+   // In a gray-scale image a flipped pixel is given one of the other q-1
+   //    levels at random, and p is the chance it ends up at a level other
+   //    than its own. Each wrong level is then as likely as any other, so
+   //    the energy just counts the pixels that differ from the degraded
+   //    image, as for black and white images, but lambda depends on q.
+   // The comment in the image file gives the years of degradation. If it
+   //    does not (e.g., for a scan), ask for p.
+   N = (double) W * H;
+   if (sscanf (comment, "%lf", &t) == 1 && t > 0) {
+      printf ("I'm reconstructing a %d x %d image degraded %.0f years.\n", W, H, t);
+      p = (q-1.0)/q * (1.0 - pow (1.0 - q/((q-1.0)*N), N/1000.0*t));
+   } else {
+      printf ("I'm reconstructing a %d x %d image.\n", W, H);
+      p = GetDouble ("\nWhat fraction of the pixels do you think are wrong (.01 to .49)?... ");
+   }
 
    // This parameter is used in the energy computation, which is why "t" is
    //    needed as an input to Metropolis.
-   lambda = 1.0 / (1.0 + log((1.0-p)/p));
-
-   // Start the Markov chain in the degraded state.
-   CopyImage (d, x);
+   lambda = 1.0 / (1.0 + log((1.0-p)*(q-1)/p));
 
-   // Initially the degraded image itself is the best reconstruction so far.
-   CopyImage (d, best);
+   return;
 
 }
 
@@ -122,17 +369,34 @@ void GetDegradedImage () {
 ////////////////////////////////////////////////////////////////////////////////
 void Metropolis () {
 
-   int i0, j0, NextReport, AcceptTransition, n;
-   double U, p, T, E, DeltaE, t, t1;
+   int mode, pyramid;
+   double T, E, DeltaE, t, t1, n, NextReport;
+
+   // Gray-scale images are reconstructed separately.
+   if (q > 2) {
+      GrayMetropolis ();
+   }
+
+   // Get the kind of proposal, or skip Metropolis and find the exact answer,
+   //    or average samples instead of looking for the lowest energy.
+   mode = GetInteger ("\nFlip one random pixel at a time (0), sweep the checkerboard (1),"
+                      "\nfind the lowest energy image exactly with a graph cut (2),"
+                      "\nflip pixels picked mostly from boundaries (3),"
+                      "\naverage many samples pixel by pixel (4),"
+                      "\nor sweep the checkerboard and flip clusters of pixels in turn (5)?... ");
+   if (mode == 2) {
+      ExactReconstruction ();
+   }
+   if (mode == 4) {
+      MarginalReconstruction ();
+   }
 
    // Get the temperature.
    T = GetDouble ("\nWhat is the temperature (best about 0.1)?... ");
 
-   // Initalize the energy of the image E and the lowest energy found
-   //    so far E_min.
-   // Since we are not interested in the value of the minimal energy (only
-   //    in the minimizing configuration), E can be set to any value.
-   E_min = E = Energy ();
+   // Get the starting image.
+   pyramid = GetInteger ("\nStart from the degraded image (0) or from a coarse-to-fine"
+                         "\nreconstruction (1)?... ");
 
    // Report next image at Markov chain period number "NextReport".
    // Reports are generated at 1000, 10000, 100000, 1000000, 10000000, and
@@ -141,51 +405,73 @@ void Metropolis () {
    n = 0;
 
    printf ("\nI'll be done in 60 seconds. ");
-   t = t1 = Time ();
+   t = t1 = WallTime ();
+
+   // Reconstruct smaller copies of the image first, if asked to. Their steps
+   //    count as Markov chain steps, and the result is the best so far.
+   if (pyramid) {
+      n = Pyramid (T);
+      CopyImage (x, best);
+   }
+   if (mode == 1 || mode == 5) Thresholds (T, H);
+
+   // Initalize the energy of the image E and the lowest energy found
+   //    so far E_min.
+   // Since we are not interested in the value of the minimal energy (only
+   //    in the minimizing configuration), E can be set to any value.
+   E_min = E = Energy ();
+
+   // Find the pixels worth proposing to flip.
+   if (mode == 3) ActiveSet ();
 
    // Run the Markov chain for 60 seconds.
    // The image "x" will always be the current value of the Markov chain.
    while (t < 60.0) {
 
+      // Checkerboard sweeps: each one offers a flip to every pixel. In mode 5
+      //    each is followed by a cluster sweep, which moves whole blobs but
+      //    leaves a lone pixel to the degraded image alone.
+      if (mode == 1 || mode == 5) {
+
+         // Offer each color of the checkerboard a flip in turn, then each
+         //    cluster.
+         E += Sweep ();
+         if (mode == 5) E += ClusterSweep (T);
+         if (E < E_min) {
+            E_min = E;
+            CopyImage (x, best);
+         }
+
+         // Count the pixels offered a flip as Markov chain steps.
+         n += (double) W*H;
+         if (n >= NextReport && NextReport <= 100000000) {
+            ReportImage ();
+            NextReport *= 10;
+         }
+
+         t = WallTime ();
+         if (t > t1 + 5.0) {
+            printf (". ");
+            t1 = t;
+         }
+
+         continue;
+
+      }
+
       // Increment Markov chain step counter.
       n ++;
 
       // Every five seconds indicate that it's still thinking.
-      t = Time ();
+      t = WallTime ();
       if (t > t1 + 5.0) {
          printf (". ");
          t1 = t;
       }
 
-      // Generate proposed transition -- (i0,j0) is the proposed pixel to flip.
-      i0 = RandomInteger (1, 200);
-      j0 = RandomInteger (1, 200);
-
-      // Compute the change in energy associated with a flip of that pixel...
-      DeltaE = DeltaEnergy (i0, j0);
-
-      // Start with the zero-temperature dynamics.
-      AcceptTransition = 0;
-      if (DeltaE <= 0) {
-         AcceptTransition = 1;
-      }
-
-      // If T > 0 -- accept an increase in energy with the appropriate
-      //   probability, called "p" below.
-      else if (T > 0) {
-         p = exp (-DeltaE / T);
-         U = MTUniform ();
-         if (U <= p) {
-            AcceptTransition = 1;
-         }   
-      }
-
-      // Effect the transition if indicated. Compute the new energy and if it
-      //    is the best-found-so-far, record relevant information.
-      if (AcceptTransition) {
-
-         // Flip site (i0,j0).
-         x[i0][j0] = 1 - x[i0][j0];
+      // Propose a flip, and make it if it is accepted. Compute the new energy
+      //    and if it is the best-found-so-far, record relevant information.
+      if (Step (mode, T, &DeltaE)) {
 
          // Update the current energy of the image.
          E += DeltaE;
@@ -196,15 +482,16 @@ void Metropolis () {
             // Record the new lowest energy found so far.
             E_min = E;
 
-            // Record the new lowest energy image.
-            CopyImage (x, best);
+            // Record the new lowest energy image. Only its place in the
+            //    journal is noted; it is put together when needed.
+            NewBest ();
 
          }
-         
+
       }
 
       // Periodically report the reconstructed image to an output file.
-      if (n == NextReport) {
+      if (n >= NextReport && NextReport <= 100000000) {
 
          // Report the image as currently reconstructed.
          ReportImage ();
@@ -216,13 +503,21 @@ void Metropolis () {
 
    } // This ends the Markov chain for loop.
 
-   // Report the lowest energy reconstruction.
+   // Report any images not yet reported, then the lowest energy reconstruction.
+   while (NextReport <= 100000000) {
+      ReportImage ();
+      NextReport *= 10;
+   }
+   BestImage ();
    ReportImage ();
 
    // Finish up.
    printf ("\n\n");
    printf ("%.1f million Markov chain steps completed in 60 seconds.\n\n", n/1000000.0);
-   printf ("View the reconstruction process with ShowImageReconstruction.tex using Plain TeX.\n");
+   printf ("The reconstruction process is in 1000.pbm, ..., BestReconstruction.pbm.\n");
+   if (W <= 200 && H <= 200) {
+      printf ("View it with ShowImageReconstruction.tex using Plain TeX.\n");
+   }
 
    // Pause and exit program.
    Exit ();
@@ -234,68 +529,97 @@ void Metropolis () {
 ////////////////////////////////////////////////////////////////////////////////
 void AllocateImageMemory () {
 
-   // Allocate space for a 200 x 200 pixel image plus boundary.
-   // Make the image all white -- this happens by default because
-   // calloc() initializes arrays to 0. Allocate for x, d, and best.
+   // Make the images all white -- this happens by default because
+   // calloc() initializes arrays to 0. Allocate for x and best; the degraded
+   // image d has been read in already.
+   // Gray-scale images are allocated instead for gray-scale reconstruction.
+
+   if (q > 2) {
+      gx = AllocateGrayImage ();
+      gbest = AllocateGrayImage ();
+   } else {
+      x = AllocateImage ();
+      best = AllocateImage ();
+   }
 
-   int i;
+   // Applying a full journal takes about as long as copying an image.
+   journalSize = (int) (q > 2 ? (long long) H * (W+2) / 8 : (long long) H * S);
+   journal = (int *) calloc (2*journalSize, sizeof (int));
 
-   // "x" image.
-   x = (int **) calloc (202, sizeof (int));
-   for (i = 0; i <= 201; i++) {
-      x[i] = (int *) calloc (202, sizeof (int));
-   }
+   return;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Report the images in turn: the degraded image, the images at 1000, 10000, ///
+// ... steps, and the best reconstruction. Each goes to a PBM file (except /////
+// the degraded image, which is one already), and for images up to 200 x 200 //
+// the coordinates of all blackened pixels also go to a text file for //////////
+// ShowImageReconstruction.tex. ////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+void ReportImage () {
 
-   // "d" image.
-   d = (int **) calloc (202, sizeof (int));
-   for (i = 0; i <= 201; i++) {
-      d[i] = (int *) calloc (202, sizeof (int));
+   static int n = 0;
+   unsigned long long *image;
+   char filename[10][100] = {"DegradedImage", "1000", "10000",
+                             "100000", "1000000", "10000000",
+                             "100000000", "BestReconstruction"};
+   char name[120];
+
+   // Gray-scale images go to PGM files.
+   if (q > 2) {
+      if (n > 0) {
+         sprintf (name, "%s.pgm", filename[n]);
+         WritePGM (name, n < 7 ? gx : gbest, q-1,
+                   n < 7 ? "Reconstruction in progress" : "Best reconstruction");
+      }
+      n ++;
+      return;
    }
 
-   // "best" image.
-   best = (int **) calloc (202, sizeof (int));
-   for (i = 0; i <= 201; i++) {
-      best[i] = (int *) calloc (202, sizeof (int));
+   // Usually report image "x", "best" is the last reported.
+   image = (n < 7 ? x : best);
+
+   if (n > 0) {
+      sprintf (name, "%s.pbm", filename[n]);
+      WritePBM (name, image, n < 7 ? "Reconstruction in progress" : "Best reconstruction");
    }
 
-   return;
+   WriteCoordinates (filename[n], image);
 
-}
+   // Next image.
+   n ++;
 
+   return;
 
+}
 
 ////////////////////////////////////////////////////////////////////////////////
-// Report the specified image to the specified output file. The coordinates ////
-// of all blackened pixels are reported on a [-1,1] x [-1,1] scale. ////////////
+// For images up to 200 x 200, write the coordinates of the blackened pixels of
+//    "image" to the text file name.txt for ShowImageReconstruction.tex.
 ////////////////////////////////////////////////////////////////////////////////
-void ReportImage () {
+void WriteCoordinates (const char *name, unsigned long long *image) {
 
-   static n = 0;
-   int i, j, **image;
+   int i, j;
+   char filename[120];
    FILE *fp;
-   char filename[10][100] = {"DegradedImage.txt", "1000.txt", "10000.txt",
-                             "100000.txt", "1000000.txt", "10000000.txt",
-                             "100000000.txt", "BestReconstruction.txt"};
 
-   // Usually report image "x", "best" is the last reported.
-   image = (n < 7 ? x : best);
+   if (W > 200 || H > 200) return;
 
    // Open the appropriate output file.
-   fp = fopen (filename[n], "w");
+   sprintf (filename, "%s.txt", name);
+   fp = fopen (filename, "w");
 
    // Now report the coordinates of the blackened pixels to a file.
-   for (i = 1; i <= 200; i++) {
-      for (j = 1; j <= 200; j++) {
-         if (image[i][j]) {
+   for (i = 1; i <= W; i++) {
+      for (j = 1; j <= H; j++) {
+         if (Pixel (image, i, j)) {
             fprintf (fp, "%d %d\n", i, j);
          }
       }
    }
    fclose (fp);
 
-   // Next image.
-   n ++;
-
    return;
 
 }
@@ -303,42 +627,104 @@ void ReportImage () {
 ////////////////////////////////////////////////////////////////////////////////
 // Copy image "from" into image "to" ///////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
-void CopyImage (int **from, int **to) {
+void CopyImage (unsigned long long *from, unsigned long long *to) {
 
-   int i, j;
+   memcpy (to, from, (long long) H * S * sizeof (unsigned long long));
+
+   return;
+
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Note in the journal that pixel (i,j) of "x" has been flipped (for gray-scale
+//    images, that pixel i of "gx" has been changed to level j).
+////////////////////////////////////////////////////////////////////////////////
+void Journal (int i, int j) {
+
+   if (journalLength < 0) return;
+
+   if (journalLength < journalSize) {
+      journal[2*journalLength] = i;
+      journal[2*journalLength+1] = j;
+      journalLength ++;
+   }
+
+   // The journal is full: bring "best" up to date and stop journaling until
+   //    the next new lowest energy.
+   else {
+      BestImage ();
+   }
+
+   return;
+
+}
 
-   for (i = 1; i <= 200; i++) {
-      for (j = 1; j <= 200; j++) {
-         to[i][j] = from[i][j];
+////////////////////////////////////////////////////////////////////////////////
+// "x" is the new lowest energy image.
+////////////////////////////////////////////////////////////////////////////////
+void NewBest () {
+
+   // If the journal has been stopped, copy the image and start it again.
+   if (journalLength < 0) {
+      if (q > 2) {
+         CopyGray (gx, gbest);
+      } else {
+         CopyImage (x, best);
       }
+      journalLength = 0;
    }
 
+   bestLength = journalLength;
+
    return;
 
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Bring "best" up to date by applying the flips in the journal that lead to
+//    it. The rest of the journal is then of no use, so it is stopped.
+////////////////////////////////////////////////////////////////////////////////
+void BestImage () {
+
+   int k;
+
+   for (k = 0; k < bestLength; k++) {
+      if (q > 2) {
+         gbest[journal[2*k]] = journal[2*k+1];
+      } else {
+         FlipPixel (best, journal[2*k], journal[2*k+1]);
+      }
+   }
+   bestLength = 0;
+   journalLength = -1;
+
+   return;
+
+}
 
 /////////////////////////////////////////////////////////////////////////////////
 // Compute the energy of configuration "x". /////////////////////////////////////
+// Each boundary segment is counted once, including those along the edge of
+//    the image (next to the white border), as in DeltaEnergy ().
 /////////////////////////////////////////////////////////////////////////////////
 double Energy () {
 
-   int i, j;
-   double b, D = 0, B = 0;
+   int r, w;
+   unsigned long long *row, left;
+   double D = 0, B = 0;
 
-   for (i = 1; i <= 200; i++) {
-      for (j = 1; j <= 200; j++) {
+   for (r = -1; r < H; r++) {
+      row = x + r*S;
+      for (w = 0; w <= S-2; w++) {
 
-         // First compute the number of boundary segments around (i,j).
-         b  =    (x[i][j+1] != x[i][j])   // boundary with northern neighbor?
-               + (x[i+1][j] != x[i][j])   // eastern neighbor?
-               + (x[i][j-1] != x[i][j])   // southern neighbor?
-               + (x[i-1][j] != x[i][j]);  // western neighbor?
-         // Multiply by 1/2 to reflect double counting.
-         B += 0.5 * b;
+         // Boundaries with the pixel to the left, and with the pixel below.
+         left = (row[w] >> 1) | (row[w-1] << 63);
+         B += __builtin_popcountll (row[w] ^ left);
+         if (w < S-2) B += __builtin_popcountll (row[w] ^ row[w+S]);
 
-         // Now see if pixel (i,j) disagrees with the original image.
-         D += (x[i][j] != d[i][j]);
+         // Pixels that disagree with the degraded image.
+         if (r >= 0 && w < S-2) D += __builtin_popcountll (row[w] ^ d[r*S + w]);
 
       }
    }
@@ -354,14 +740,17 @@ double DeltaEnergy (int i0, int j0) {
 
    double b, DeltaD, DeltaB, DeltaE;
 
+   int c;
+
    // - First compute Delta D.
-   DeltaD = (x[i0][j0] == d[i0][j0] ? 1 : -1);
+   c = Pixel (x, i0, j0);
+   DeltaD = (c == Pixel (d, i0, j0) ? 1 : -1);
 
    // - Now compute Delta B.
-   b  =    (x[i0][j0+1] != x[i0][j0])   // boundary with northern neighbor?
-         + (x[i0+1][j0] != x[i0][j0])   // eastern neighbor?
-         + (x[i0][j0-1] != x[i0][j0])   // southern neighbor?
-         + (x[i0-1][j0] != x[i0][j0]);  // western neighbor?
+   b  =    (Pixel (x, i0, j0+1) != c)   // boundary with northern neighbor?
+         + (Pixel (x, i0+1, j0) != c)   // eastern neighbor?
+         + (Pixel (x, i0, j0-1) != c)   // southern neighbor?
+         + (Pixel (x, i0-1, j0) != c);  // western neighbor?
    DeltaB = 4 - 2*b;
 
    // - Now compute Delta E.
@@ -371,6 +760,1971 @@ double DeltaEnergy (int i0, int j0) {
 
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// One step of the Markov chain at temperature T, proposing to flip a pixel
+//    picked at random (mode 0) or mostly from the active set (mode 3). If the
+//    flip is accepted, it is made and noted in the journal, the change in
+//    energy is put in *DeltaE, and 1 is returned; otherwise 0 is returned.
+////////////////////////////////////////////////////////////////////////////////
+int Step (int mode, double T, double *DeltaE) {
+
+   int i0, j0, k, AcceptTransition;
+   double U, p;
+
+   // Generate proposed transition -- (i0,j0) is the proposed pixel to flip,
+   //    for mode 3 usually one in the active set.
+   if (mode == 3 && nMembers > 0 && MTUniform () < FOCUS) {
+      k = members[RandomInteger (0, nMembers-1)];
+      i0 = k % W + 1;
+      j0 = H - k / W;
+   } else {
+      i0 = RandomInteger (1, W);
+      j0 = RandomInteger (1, H);
+   }
+
+   // Compute the change in energy associated with a flip of that pixel...
+   *DeltaE = DeltaEnergy (i0, j0);
+
+   // The pixels are not proposed uniformly in mode 3, so the probability
+   //    of accepting a flip includes the Hastings ratio. It takes a while
+   //    to find, so first check that the flip has a chance.
+   AcceptTransition = 0;
+   if (mode == 3 && T > 0) {
+      p = exp (-*DeltaE / T);
+      U = MTUniform ();
+      if (U <= p * MostRatio (i0, j0) && U <= p * HastingsRatio (i0, j0)) {
+         AcceptTransition = 1;
+      }
+   }
+
+   // Start with the zero-temperature dynamics.
+   else if (*DeltaE <= 0) {
+      AcceptTransition = 1;
+   }
+
+   // If T > 0 -- accept an increase in energy with the appropriate
+   //   probability, called "p" below.
+   else if (T > 0) {
+      p = exp (-*DeltaE / T);
+      U = MTUniform ();
+      if (U <= p) {
+         AcceptTransition = 1;
+      }   
+   }
+
+   // Effect the transition if indicated: flip site (i0,j0), and note it in the
+   //    journal.
+   if (AcceptTransition) {
+      FlipPixel (x, i0, j0);
+      Journal (i0, j0);
+      if (mode == 3) UpdateActiveSet (i0, j0);
+   }
+
+   return AcceptTransition;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// One Swendsen-Wang sweep at temperature T. Neighboring pixels of the same
+//    color are bonded with probability 1 - exp(-lambda/T), and the pixels
+//    bonded together, directly or through others, form a cluster. Given the
+//    bonds, each cluster is black or white independently of the others, with
+//    odds set by the energy it adds from the degraded image and the white
+//    border alone (its boundaries are all taken care of by the bonds), and
+//    it is colored accordingly (a "heat bath"). A whole misread blob can
+//    change color at once, where single flips would have to work their way
+//    in from its edge uphill. A pixel unlike all its neighbors has no bonds,
+//    though, and is colored by the degraded image alone, so these sweeps
+//    clean up no noise; they are used between checkerboard sweeps.
+// Returns the change in energy.
+////////////////////////////////////////////////////////////////////////////////
+double ClusterSweep (double T) {
+
+   int r, i, p, c, N;
+   static int allocated = 0;
+   unsigned long long bond;
+   double E0, black;
+
+   // Allocate the cluster arrays, again whenever the image size changes (as
+   //    it can between the images of a benchmark).
+   N = W*H;
+   if (N != allocated) {
+      free (cluster);
+      free (field);
+      free (clusterColor);
+      allocated = N;
+      cluster = (int *) calloc (N, sizeof (int));
+      field = (double *) calloc (N, sizeof (double));
+      clusterColor = (char *) calloc (N, sizeof (char));
+      if (cluster == NULL || field == NULL || clusterColor == NULL) {
+         printf ("There is not enough memory for the clusters.\n");
+         Exit ();
+      }
+   }
+
+   E0 = Energy ();
+
+   // A bond is made if a random 32-bit integer is below "bond".
+   bond = (T > 0 ? (unsigned long long) ((1.0 - exp (-lambda / T)) * 4294967296.0)
+                 : 1ULL << 32);
+
+   for (p = 0; p < N; p++) {
+      cluster[p] = p;
+      field[p] = 0;
+   }
+
+   // Bond each pixel to its eastern and southern neighbors.
+   for (r = 0; r < H; r++) {
+      for (i = 1; i <= W; i++) {
+         p = r*W + i-1;
+         c = Pixel (x, i, H-r);
+         if (i < W && Pixel (x, i+1, H-r) == c && (RandomBits (rng) >> 32) < bond) {
+            Join (p, p+1);
+         }
+         if (r < H-1 && Pixel (x, i, H-r-1) == c && (RandomBits (rng) >> 32) < bond) {
+            Join (p, p+W);
+         }
+      }
+   }
+
+   // A pixel adds 1-lambda to the energy if it differs from the degraded
+   //    image, and if black, lambda for each side on the white border.
+   for (r = 0; r < H; r++) {
+      for (i = 1; i <= W; i++) {
+         p = r*W + i-1;
+         field[Root (p)] += (Pixel (d, i, H-r) ? lambda - 1.0 : 1.0 - lambda)
+                          + lambda * ((i == 1) + (i == W) + (r == 0) + (r == H-1));
+      }
+   }
+
+   // Color each cluster: black with probability 1 / (1 + exp(field/T)).
+   for (p = 0; p < N; p++) {
+      if (cluster[p] == p) {
+         if (T > 0) {
+            black = 1.0 / (1.0 + exp (field[p] / T));
+         } else {
+            black = (field[p] < 0 ? 1 : field[p] > 0 ? 0 : 0.5);
+         }
+         clusterColor[p] = (MTUniform () < black);
+      }
+   }
+
+   for (r = 0; r < H; r++) {
+      for (i = 1; i <= W; i++) {
+         if (Pixel (x, i, H-r) != clusterColor[Root (r*W + i-1)]) {
+            FlipPixel (x, i, H-r);
+         }
+      }
+   }
+
+   return Energy () - E0;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The root of pixel p's cluster. The path to it is halved on the way, so
+//    later searches are quicker.
+////////////////////////////////////////////////////////////////////////////////
+int Root (int p) {
+
+   while (cluster[p] != p) {
+      cluster[p] = cluster[cluster[p]];
+      p = cluster[p];
+   }
+
+   return p;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Join the clusters of pixels a and b, under the lower numbered root.
+////////////////////////////////////////////////////////////////////////////////
+void Join (int a, int b) {
+
+   a = Root (a);
+   b = Root (b);
+   if (a < b) cluster[b] = a;
+   if (b < a) cluster[a] = b;
+
+   return;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Put every pixel of "x" that is active (see Active ()) in the active set.
+////////////////////////////////////////////////////////////////////////////////
+void ActiveSet () {
+
+   int i, j;
+
+   free (members);
+   free (place);
+   members = (int *) calloc (W*H, sizeof (int));
+   place = (int *) calloc (W*H, sizeof (int));
+   if (members == NULL || place == NULL) {
+      printf ("There is not enough memory for the active set.\n");
+      Exit ();
+   }
+
+   nMembers = 0;
+   for (j = H; j >= 1; j--) {
+      for (i = 1; i <= W; i++) {
+         place[(H-j)*W + i-1] = -1;
+         if (Active (i, j)) {
+            place[(H-j)*W + i-1] = nMembers;
+            members[nMembers++] = (H-j)*W + i-1;
+         }
+      }
+   }
+
+   return;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Pixel (i,j) of "x" is active (1) if it differs from one of its neighbors, and
+//    not (0) otherwise. Pixels that differ from the degraded image are not
+//    active for that alone: once the noise is cleaned up most of them sit in
+//    regions of one color, where a flip is almost never accepted. Pixels
+//    outside the image are never active.
+////////////////////////////////////////////////////////////////////////////////
+int Active (int i, int j) {
+
+   int c;
+
+   if (i < 1 || i > W || j < 1 || j > H) return 0;
+
+   c = Pixel (x, i, j);
+
+   return c != Pixel (x, i, j+1) || c != Pixel (x, i+1, j)
+       || c != Pixel (x, i, j-1) || c != Pixel (x, i-1, j);
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Pixel (i0,j0) has just been flipped: only it and its neighbors can have
+//    joined or left the active set. A pixel leaves by swapping places with
+//    the last member.
+////////////////////////////////////////////////////////////////////////////////
+void UpdateActiveSet (int i0, int j0) {
+
+   int k, i, j, p, active, last,
+       di[5] = {0, 0, 1, 0, -1},
+       dj[5] = {0, 1, 0, -1, 0};
+
+   for (k = 0; k < 5; k++) {
+
+      i = i0 + di[k];
+      j = j0 + dj[k];
+      if (i < 1 || i > W || j < 1 || j > H) continue;
+      p = (H-j)*W + i-1;
+
+      active = Active (i, j);
+      if (active && place[p] < 0) {
+         place[p] = nMembers;
+         members[nMembers++] = p;
+      }
+      else if (!active && place[p] >= 0) {
+         last = members[--nMembers];
+         members[place[p]] = last;
+         place[last] = place[p];
+         place[p] = -1;
+      }
+
+   }
+
+   return;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The probability of proposing a pixel that is in the active set (active = 1)
+//    or not (0), when the set has n members.
+////////////////////////////////////////////////////////////////////////////////
+double Proposal (int active, int n) {
+
+   if (n == 0) return 1.0 / ((double) W*H);
 
+   return FOCUS * active / n + (1.0 - FOCUS) / ((double) W*H);
 
+}
 
+////////////////////////////////////////////////////////////////////////////////
+// The Hastings ratio for a flip of pixel (i0,j0): the probability of proposing
+//    it again to flip it back, once flipped, over the probability of proposing
+//    it now. The flip only changes whether it and its neighbors are active,
+//    so the new size of the set is found by trying the flip on them.
+////////////////////////////////////////////////////////////////////////////////
+double HastingsRatio (int i0, int j0) {
+
+   int k, i, j, p, n, active,
+       di[5] = {0, 0, 1, 0, -1},
+       dj[5] = {0, 1, 0, -1, 0};
+   double before;
+
+   p = (H-j0)*W + i0-1;
+   before = Proposal (place[p] >= 0, nMembers);
+
+   FlipPixel (x, i0, j0);
+   n = nMembers;
+   for (k = 0; k < 5; k++) {
+      i = i0 + di[k];
+      j = j0 + dj[k];
+      if (i < 1 || i > W || j < 1 || j > H) continue;
+      n += Active (i, j) - (place[(H-j)*W + i-1] >= 0);
+   }
+   active = Active (i0, j0);
+   FlipPixel (x, i0, j0);
+
+   return Proposal (active, n) / before;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// An upper bound on HastingsRatio (i0,j0), found without trying the flip: at
+//    most five pixels can leave the active set.
+////////////////////////////////////////////////////////////////////////////////
+double MostRatio (int i0, int j0) {
+
+   int p;
+   double most;
+
+   p = (H-j0)*W + i0-1;
+   most = (nMembers > 5 ? Proposal (1, nMembers-5) : 1.0);
+
+   return most / Proposal (place[p] >= 0, nMembers);
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// One checkerboard sweep at the temperature last set by Thresholds ().
+//    Pixel (i,j) is black on the checkerboard if i+j is even. No two black
+//    pixels are neighbors, so a flip of one does not change Delta E for
+//    another, and all the black pixels can be offered a flip at once; then all
+//    the white ones. Each row is handled
+//    by one thread at a time with its own random number stream, so the result
+//    does not depend on the number of threads.
+// The pixels are handled a word at a time ("multi-spin coding"): for the 32
+//    pixels of one color in a word, bit operations count the disagreeing
+//    neighbors, sort the pixels into the ten cases of Threshold[a][b], and
+//    decide which flips are accepted, all at once (see SweepWord ()).
+// Returns the change in energy.
+////////////////////////////////////////////////////////////////////////////////
+double Sweep () {
+
+   int r, w, color;
+   unsigned long long mask, last;
+   double DeltaE = 0;
+
+   // Mask for the bits of the last word of each row that are in the image.
+   last = ~0ULL << (63 - (W-1) % 64);
+
+   for (color = 0; color <= 1; color++) {
+
+      #pragma omp parallel for private(w, mask) reduction(+:DeltaE) schedule(static)
+      for (r = 0; r < H; r++) {
+
+         // Pixel (i,j) in bit k of a word has i+j = 64*w + 64 - k + H - r, so
+         //    the pixels of this color are the odd or even bits.
+         mask = ((H - r + color) % 2) ? 0xAAAAAAAAAAAAAAAAULL : 0x5555555555555555ULL;
+
+         for (w = 0; w < S-2; w++) {
+            DeltaE += SweepWord (x + r*S + w, d[r*S + w],
+                                 w < S-3 ? mask : mask & last, rng + r, S);
+         }
+
+      }
+
+   }
+
+   return DeltaE;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Offer a flip to each pixel of word *X that is marked in "mask", using the
+//    degraded image's word D and random number stream "state". Rows of the
+//    image X are s words apart. Returns the change in energy.
+////////////////////////////////////////////////////////////////////////////////
+double SweepWord (unsigned long long *X, unsigned long long D,
+                  unsigned long long mask, unsigned long long *state, int s) {
+
+   int a, b, k, c, n;
+   unsigned long long e1, e2, e3, e4, s0, c0, s1, c1, lo, mid, hi, carry,
+                      bcount[5], agree, m, accept, undecided, R, P,
+                      cases[10], threshold[10];
+   double DeltaE, change[10];
+
+   // Bit k of e1,...,e4 is 1 if the pixel in bit k disagrees with its
+   //    northern, southern, western, or eastern neighbor.
+   e1 = *X ^ X[-s];
+   e2 = *X ^ X[s];
+   e3 = *X ^ ((*X >> 1) | (X[-1] << 63));
+   e4 = *X ^ ((*X << 1) | (X[1] >> 63));
+
+   // Add them up bit by bit: the number of disagreeing neighbors has bits
+   //    hi, mid, lo.
+   s0 = e1 ^ e2;  c0 = e1 & e2;
+   s1 = e3 ^ e4;  c1 = e3 & e4;
+   lo = s0 ^ s1;  carry = s0 & s1;
+   mid = c0 ^ c1 ^ carry;
+   hi = (c0 & c1) | (carry & (c0 ^ c1));
+   bcount[0] = ~hi & ~mid & ~lo;
+   bcount[1] = ~hi & ~mid &  lo;
+   bcount[2] = ~hi &  mid & ~lo;
+   bcount[3] = ~hi &  mid &  lo;
+   bcount[4] =  hi;
+
+   // Sort the pixels into cases. Flips that are always accepted (Threshold
+   //    2^32) are accepted now, those never accepted (Threshold 0, which is
+   //    most pixels in the middle of a region at low temperature) are left
+   //    alone, and the other cases present are listed.
+   agree = ~(*X ^ D);
+   accept = 0;
+   DeltaE = 0;
+   n = 0;
+   for (a = 0; a <= 1; a++) {
+      for (b = 0; b <= 4; b++) {
+         m = mask & (a ? agree : ~agree) & bcount[b];
+         if (m == 0 || Threshold[a][b] == 0) continue;
+         if (Threshold[a][b] >> 32) {
+            accept |= m;
+            DeltaE += __builtin_popcountll (m) * Change[a][b];
+         } else {
+            cases[n] = m;
+            threshold[n] = Threshold[a][b];
+            change[n] = Change[a][b];
+            n ++;
+         }
+      }
+   }
+
+   // Compare a random 32-bit integer for each remaining pixel with its
+   //    threshold, a bit at a time from the top, until every pixel is
+   //    decided. Each random bit has a 1/2 chance of deciding a pixel, so
+   //    this takes only a few rounds.
+   undecided = 0;
+   for (c = 0; c < n; c++) {
+      undecided |= cases[c];
+   }
+   m = accept;
+   for (k = 31; k >= 0 && undecided; k--) {
+      P = 0;
+      for (c = 0; c < n; c++) {
+         P |= cases[c] & (0 - ((threshold[c] >> k) & 1));
+      }
+      R = RandomBits (state);
+      accept |= undecided & P & ~R;
+      undecided &= ~(P ^ R);
+   }
+
+   // Flip the accepted pixels and add up the change in energy.
+   *X ^= accept;
+   accept &= ~m;
+   for (c = 0; c < n && accept; c++) {
+      DeltaE += __builtin_popcountll (cases[c] & accept) * change[c];
+   }
+
+   return DeltaE;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Reconstruct the image coarse to fine, starting from "x" = "d". The degraded
+//    image is shrunk by half again and again, each pixel of a smaller copy
+//    taking the majority color of the 2 x 2 block under it (the top left
+//    pixel breaks ties). Large patches of noise shrink to specks, which a few
+//    sweeps clean up, so the smallest copy is reconstructed first. Each
+//    reconstruction is then enlarged to start the reconstruction of the next
+//    larger copy, and the last one is put in "x".
+// Each copy gets 50 checkerboard sweeps at temperature T, with lambda for the
+//    chance that a pixel of the copy is wrong. Returns the number of pixels
+//    offered a flip.
+////////////////////////////////////////////////////////////////////////////////
+double Pyramid (double T) {
+
+   int L, levels, i, j, a, b, w[20], h[20], blacks, pixels, sweep;
+   unsigned long long *dd[20], *xx[20], *x0;
+   unsigned char *color;
+   double n, p[20], lambda0;
+
+   // Halve the image until it is about 32 pixels across.
+   levels = 0;
+   w[0] = W;
+   h[0] = H;
+   while (levels < 19 && w[levels] >= 64 && h[levels] >= 64) {
+      w[levels+1] = (w[levels] + 1) / 2;
+      h[levels+1] = (h[levels] + 1) / 2;
+      levels ++;
+   }
+   if (levels == 0) return 0;
+
+   x0 = x;
+   dd[0] = d;
+   lambda0 = lambda;
+   p[0] = 1.0 / (1.0 + exp (1.0/lambda - 1.0));
+
+   // Make the smaller copies of the degraded image. The colors of the larger
+   //    copy are unpacked to bytes first, as its image size is then needed.
+   color = (unsigned char *) calloc (W*H, sizeof (unsigned char));
+   for (L = 1; L <= levels; L++) {
+
+      // A pixel of the copy is wrong if most of its block (or the top left
+      //    pixel, in a tie) is wrong.
+      p[L] = pow (p[L-1], 4) + 4*pow (p[L-1], 3)*(1-p[L-1])
+           + 3*pow (p[L-1], 2)*pow (1-p[L-1], 2);
+
+      SetImageSize (w[L-1], h[L-1]);
+      for (i = 1; i <= W; i++) {
+         for (j = 1; j <= H; j++) {
+            color[(j-1)*W + i-1] = Pixel (dd[L-1], i, j);
+         }
+      }
+      SetImageSize (w[L], h[L]);
+      dd[L] = AllocateImage ();
+      for (i = 1; i <= W; i++) {
+         for (j = 1; j <= H; j++) {
+            blacks = pixels = 0;
+            for (a = 2*i-1; a <= 2*i && a <= w[L-1]; a++) {
+               for (b = 2*j-1; b <= 2*j && b <= h[L-1]; b++) {
+                  blacks += color[(b-1)*w[L-1] + a-1];
+                  pixels ++;
+               }
+            }
+            b = (2*j <= h[L-1] ? 2*j : 2*j-1);
+            if (2*blacks > pixels || (2*blacks == pixels && color[(b-1)*w[L-1] + 2*i-2])) {
+               FlipPixel (dd[L], i, j);
+            }
+         }
+      }
+   }
+
+   // Reconstruct the copies, smallest first.
+   n = 0;
+   for (L = levels; L >= 1; L--) {
+
+      SetImageSize (w[L], h[L]);
+      d = dd[L];
+      x = xx[L] = AllocateImage ();
+
+      // Start from the degraded copy, or from the reconstruction of the next
+      //    smaller copy, enlarged.
+      if (L == levels) {
+         CopyImage (d, x);
+      } else {
+         for (i = 1; i <= W; i++) {
+            for (j = 1; j <= H; j++) {
+               if (color[((j+1)/2-1)*w[L+1] + (i+1)/2-1]) FlipPixel (x, i, j);
+            }
+         }
+      }
+
+      lambda = 1.0 / (1.0 + log((1.0-p[L])/p[L]));
+      Thresholds (T, H);
+      for (sweep = 0; sweep < 50; sweep++) {
+         Sweep ();
+      }
+      n += 50.0*W*H;
+
+      // Unpack the reconstruction for the next larger copy.
+      for (i = 1; i <= W; i++) {
+         for (j = 1; j <= H; j++) {
+            color[(j-1)*W + i-1] = Pixel (x, i, j);
+         }
+      }
+
+   }
+
+   // Enlarge the last reconstruction to full size.
+   SetImageSize (w[0], h[0]);
+   d = dd[0];
+   x = x0;
+   lambda = lambda0;
+   memset (x - S - 1, 0, (long long) (H+2) * S * sizeof (unsigned long long));
+   for (i = 1; i <= W; i++) {
+      for (j = 1; j <= H; j++) {
+         if (color[((j+1)/2-1)*w[1] + (i+1)/2-1]) FlipPixel (x, i, j);
+      }
+   }
+
+   // Free the smaller copies.
+   for (L = 1; L <= levels; L++) {
+      free (dd[L] - (w[L]+63)/64 - 3);
+      free (xx[L] - (w[L]+63)/64 - 3);
+   }
+   free (color);
+
+   return n;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Compute the acceptance thresholds for checkerboard sweeps at temperature T,
+//    and seed "streams" random number streams (one for each row, or each
+//    tile) from the Mersenne Twister.
+////////////////////////////////////////////////////////////////////////////////
+void Thresholds (double T, int streams) {
+
+   int a, b, i;
+   double DeltaE, p;
+
+   for (a = 0; a <= 1; a++) {
+      for (b = 0; b <= 4; b++) {
+         Change[a][b] = DeltaE = lambda*(4 - 2*b) + (1.0-lambda)*(2*a - 1);
+         if (DeltaE <= 0) {
+            p = 1;
+         } else if (T > 0) {
+            p = exp (-DeltaE / T);
+         } else {
+            p = 0;
+         }
+         // p = 1 gives 2^32, above every 32-bit integer.
+         Threshold[a][b] = (unsigned long long) (p * 4294967296.0);
+      }
+   }
+
+   // The same for gray-scale images.
+   for (b = -4; b <= 4; b++) {
+      for (a = -1; a <= 1; a++) {
+         GrayChange[b+4][a+1] = DeltaE = lambda*b + (1.0-lambda)*a;
+         if (DeltaE <= 0) {
+            p = 1;
+         } else if (T > 0) {
+            p = exp (-DeltaE / T);
+         } else {
+            p = 0;
+         }
+         GrayThreshold[b+4][a+1] = (unsigned long long) (p * 4294967296.0);
+      }
+   }
+
+   free (rng);
+   rng = (unsigned long long *) calloc (streams, sizeof (unsigned long long));
+   for (i = 0; i < streams; i++) {
+      rng[i] = ((unsigned long long) (MTUniform () * 4294967296.0) << 32)
+             |  (unsigned long long) (MTUniform () * 4294967296.0) | 1;
+   }
+
+   return;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// 64 random bits from the stream "state" (Marsaglia's xorshift generator with
+//    a multiplicative scrambler). Unlike MTUniform () this may be used by
+//    several threads at once, each with its own stream.
+////////////////////////////////////////////////////////////////////////////////
+unsigned long long RandomBits (unsigned long long *state) {
+
+   unsigned long long z = *state;
+
+   z ^= z >> 12;
+   z ^= z << 25;
+   z ^= z >> 27;
+   *state = z;
+
+   return z * 2685821657736338717ULL;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Elapsed time in seconds. With several threads Time () would add up the time
+//    spent by all of them, so use the wall clock instead.
+////////////////////////////////////////////////////////////////////////////////
+double WallTime () {
+
+#ifdef _OPENMP
+   static double t0 = -1;
+   if (t0 < 0) t0 = omp_get_wtime ();
+   return omp_get_wtime () - t0;
+#else
+   return Time ();
+#endif
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Reconstruct the image in the PBM or PGM file "in" into the PBM file "out",
+//    for images too big to hold in memory. Both files are mapped into memory
+//    and the operating system reads and writes their pages as they are used.
+// The image is swept a tile at a time. A tile is copied out of "out" into a
+//    small packed image with a border one pixel wide (its "halo") holding its
+//    neighbors, swept several times with the halo held fixed, and copied back.
+//    A pass over the image does the tiles in four groups, like a 2 x 2
+//    checkerboard of tiles. Tiles of a group do not touch each other's halos,
+//    so they are swept at once on several cores. Each tile reads its halo
+//    afresh, so it sees its neighbors' latest pixels, and every other pass
+//    the tiles are shifted by half a tile so that the pixels along the tile
+//    edges get swept together with the pixels across from them.
+// Only the tiles being swept are held in memory, whatever the image's size.
+//    The lowest energy image is not kept; the last one is written.
+////////////////////////////////////////////////////////////////////////////////
+void Tiled (const char *in, const char *out) {
+
+#ifdef _WIN32
+
+   printf ("Tiled reconstruction needs memory-mapped files, which this program does not support on Windows.\n");
+   Exit ();
+
+#else
+
+   int r, w, k, a, b, tilesA, tilesB, tileWords, tileRows, shift, pass, passes,
+       group, sweeps;
+   long long inStart, outStart, inLength, outLength;
+   double T, t, DeltaE;
+   unsigned char *inMap, *outMap;
+   char comment[100];
+   FILE *fin, *fout;
+
+   // Tiles are 512 x 512 pixels (8 words wide), and each is swept 8 times
+   //    when it is visited.
+   tileWords = 8;
+   tileRows = 512;
+   sweeps = 8;
+
+   fin = OpenImage (in, &inType, &inMaxval, comment);
+   if (fin == NULL) {
+      printf ("I cannot read the degraded image %s.\n", in);
+      Exit ();
+   }
+   SetLambda (comment);
+
+   // Seed the RNG.
+   MTUniform ();
+
+   T = GetDouble ("\nWhat is the temperature (best about 0.1)?... ");
+   passes = GetInteger ("\nHow many passes over the image?... ");
+
+   // One random number stream for each tile, in either position.
+   tilesA = (S-2) / tileWords + 2;
+   tilesB = H / tileRows + 2;
+   Thresholds (T, tilesA * tilesB);
+
+   // Map the degraded image's pixels into memory.
+   inRow = (inType == 4 ? (W+7) / 8 : (inMaxval < 256 ? W : 2*W));
+   inStart = ftell (fin);
+   inLength = inStart + H * inRow;
+   inMap = (unsigned char *) mmap (NULL, inLength, PROT_READ, MAP_SHARED, fileno (fin), 0);
+   if (inMap == MAP_FAILED) {
+      printf ("I cannot map %s into memory.\n", in);
+      Exit ();
+   }
+   inPixels = inMap + inStart;
+
+   // Make the reconstruction file and map it into memory.
+   fout = fopen (out, "w+b");
+   if (fout == NULL) {
+      printf ("I cannot write the image file %s.\n", out);
+      Exit ();
+   }
+   fprintf (fout, "P4\n# Reconstruction\n%d %d\n", W, H);
+   fflush (fout);
+   outRow = (W+7) / 8;
+   outStart = ftell (fout);
+   outLength = outStart + H * outRow;
+   outMap = NULL;
+   if (ftruncate (fileno (fout), outLength) == 0) {
+      outMap = (unsigned char *) mmap (NULL, outLength, PROT_READ | PROT_WRITE,
+                                       MAP_SHARED, fileno (fout), 0);
+   }
+   if (outMap == NULL || outMap == MAP_FAILED) {
+      printf ("I cannot map %s into memory.\n", out);
+      Exit ();
+   }
+   outPixels = outMap + outStart;
+
+   // Start with the degraded image.
+   #pragma omp parallel for private(w) schedule(static)
+   for (r = 0; r < H; r++) {
+      for (w = 0; w < S-2; w++) {
+         PutWord (outPixels + r*outRow, w, outRow, DegradedWord (r, w));
+      }
+   }
+
+   printf ("\n");
+   t = WallTime ();
+   for (pass = 1; pass <= passes; pass++) {
+
+      shift = pass % 2 == 0;
+      DeltaE = 0;
+
+      for (group = 0; group < 4; group++) {
+
+         #pragma omp parallel for private(a, b) reduction(+:DeltaE) schedule(dynamic)
+         for (k = 0; k < tilesA * tilesB; k++) {
+
+            a = k % tilesA;
+            b = k / tilesA;
+            if (a % 2 != group % 2 || b % 2 != group / 2) continue;
+
+            // Tile (a,b) has rows r0 to r1-1 and words w0 to w1-1, less any
+            //    part outside the image.
+            DeltaE += SweepTile (b*tileRows - shift*tileRows/2,
+                                 (b+1)*tileRows - shift*tileRows/2,
+                                 a*tileWords - shift*tileWords/2,
+                                 (a+1)*tileWords - shift*tileWords/2,
+                                 sweeps, rng + k);
+
+         }
+
+      }
+
+      printf ("Pass %d: the energy went down %.1f; %.1f seconds so far.\n",
+              pass, -DeltaE, WallTime () - t);
+
+   }
+
+   // Write the reconstruction out and close the files.
+   msync (outMap, outLength, MS_SYNC);
+   munmap (outMap, outLength);
+   munmap (inMap, inLength);
+   fclose (fout);
+   fclose (fin);
+
+   printf ("\nThe reconstruction is in %s.\n", out);
+
+   Exit ();
+
+#endif
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Sweep the tile of rows r0 to r1-1 and words w0 to w1-1 of the tiled
+//    reconstruction "sweeps" times, using random number stream "state".
+//    Returns the change in energy.
+////////////////////////////////////////////////////////////////////////////////
+double SweepTile (int r0, int r1, int w0, int w1, int sweeps,
+                  unsigned long long *state) {
+
+   int r, w, rows, words, s, sweep, color;
+   unsigned long long *X, *D, mask, last;
+   double DeltaE = 0;
+
+   // Leave out any part of the tile outside the image.
+   if (r0 < 0) r0 = 0;
+   if (r1 > H) r1 = H;
+   if (w0 < 0) w0 = 0;
+   if (w1 > S-2) w1 = S-2;
+   rows = r1 - r0;
+   words = w1 - w0;
+   if (rows <= 0 || words <= 0) return 0;
+
+   // The tile and its halo are a small packed image with rows s words apart;
+   //    X points at the tile's top left word. Outside the image it is white.
+   s = words + 2;
+   X = (unsigned long long *) calloc ((rows+2) * s, sizeof (unsigned long long));
+   D = (unsigned long long *) calloc (rows * words, sizeof (unsigned long long));
+   X += s + 1;
+   for (r = -1; r <= rows; r++) {
+      if (r0 + r < 0 || r0 + r >= H) continue;
+      for (w = -1; w <= words; w++) {
+         if (w0 + w < 0 || w0 + w >= S-2) continue;
+         X[r*s + w] = GetWord (outPixels + (r0+r)*outRow, w0 + w, outRow);
+      }
+   }
+   for (r = 0; r < rows; r++) {
+      for (w = 0; w < words; w++) {
+         D[r*words + w] = DegradedWord (r0 + r, w0 + w);
+      }
+   }
+
+   // Mask for the bits of the tile's last word that are in the image.
+   last = (w1 < S-2 ? ~0ULL : ~0ULL << (63 - (W-1) % 64));
+
+   // Checkerboard sweeps, as in Sweep ().
+   for (sweep = 0; sweep < sweeps; sweep++) {
+      for (color = 0; color <= 1; color++) {
+         for (r = 0; r < rows; r++) {
+            mask = ((r + color) % 2) ? 0xAAAAAAAAAAAAAAAAULL : 0x5555555555555555ULL;
+            for (w = 0; w < words; w++) {
+               DeltaE += SweepWord (X + r*s + w, D[r*words + w],
+                                    w < words-1 ? mask : mask & last, state, s);
+            }
+         }
+      }
+   }
+
+   // Copy the tile back.
+   for (r = 0; r < rows; r++) {
+      for (w = 0; w < words; w++) {
+         PutWord (outPixels + (r0+r)*outRow, w0 + w, outRow, X[r*s + w]);
+      }
+   }
+
+   free (X - s - 1);
+   free (D);
+
+   return DeltaE;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Word w of row r of the tiled reconstruction's degraded image. A PGM image
+//    is made black and white as in GetDegradedImage ().
+////////////////////////////////////////////////////////////////////////////////
+unsigned long long DegradedWord (int r, int w) {
+
+   int k, i, mid;
+   unsigned char *row;
+   unsigned long long word = 0;
+
+   row = inPixels + r*inRow;
+
+   if (inType == 4) {
+      word = GetWord (row, w, inRow);
+   } else {
+      mid = (inMaxval < 256 ? inMaxval : inMaxval >> 8);
+      for (k = 0; k < 64; k++) {
+         i = 64*w + k;
+         if (i < W && 2*row[inMaxval < 256 ? i : 2*i] < mid) word |= 1ULL << (63 - k);
+      }
+   }
+
+   // Bits past the right edge of the image are padding; make them white.
+   if (w == S-3) word &= ~0ULL << (63 - (W-1) % 64);
+
+   return word;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Find the lowest energy image exactly with a graph cut, report it, and exit.
+////////////////////////////////////////////////////////////////////////////////
+void ExactReconstruction () {
+
+   double E, t;
+
+   printf ("\nFinding the lowest energy image... ");
+   t = WallTime ();
+   E = GraphCut ();
+   t = WallTime () - t;
+
+   // The lowest energy image is the best reconstruction.
+   CopyImage (x, best);
+   WritePBM ("BestReconstruction.pbm", best, "Lowest energy reconstruction");
+   WriteCoordinates ("BestReconstruction", best);
+
+   printf ("\n\nThe lowest energy is %.3f, found in %.2f seconds.\n\n", E, t);
+   printf ("The reconstruction is in BestReconstruction.pbm.\n");
+
+   Exit ();
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Reconstruct the image by posterior marginals, report it, and exit. Rather
+//    than the lowest energy image, each pixel is given the color it has most
+//    often in samples of the Markov chain, which for noisy images is often
+//    closer to the original and does not hang on a few lucky flips.
+// Since lambda is 1 / (1 + log((1-p)/p)), the energy at T = lambda is the
+//    log of the posterior probability of an image given the degraded one (up
+//    to a constant), so that is the natural temperature.
+// Several chains, each from the degraded image, are run by checkerboard sweeps
+//    for 60 seconds. After the first "burn" sweeps of each, every sweep adds
+//    its image to the per-pixel counts of black. The counts also give how
+//    sure each pixel is, which is reported as a gray-scale image.
+////////////////////////////////////////////////////////////////////////////////
+void MarginalReconstruction () {
+
+   int c, chains, burn, sweeps, samples = 0;
+   unsigned long long **chain, *streams;
+   unsigned int *count;
+   unsigned char *sure;
+   double T, t, t1, E;
+   char question[200];
+
+   sprintf (question, "\nWhat is the temperature (the posterior probabilities are at"
+                      "\nT = %.3f)?... ", lambda);
+   T = GetDouble (question);
+   chains = GetInteger ("\nHow many chains (e.g., 4)?... ");
+   burn = GetInteger ("\nHow many sweeps of each chain before its samples count (e.g., 100)?... ");
+   if (chains < 1) chains = 1;
+
+   // Each chain has its own image and random number streams; Sweep () works
+   //    on whichever are in "x" and "rng". Chain 0 uses "x" itself.
+   Thresholds (T, chains * H);
+   streams = rng;
+   chain = (unsigned long long **) calloc (chains, sizeof (unsigned long long *));
+   chain[0] = x;
+   for (c = 1; c < chains; c++) {
+      chain[c] = AllocateImage ();
+      CopyImage (d, chain[c]);
+   }
+
+   // The counts of black are kept a pixel to an int, 64 to a word of the
+   //    image, so adding a word of pixels is a loop the compiler vectorizes.
+   count = (unsigned int *) calloc ((long long) H * 64 * (S-2), sizeof (unsigned int));
+   if (count == NULL) {
+      printf ("There is not enough memory for the counts.\n");
+      Exit ();
+   }
+
+   printf ("\nI'll be done in 60 seconds. ");
+   t = t1 = WallTime ();
+
+   // Keep sampling for 60 seconds, and until there is at least one sample.
+   for (sweeps = 1; t < 60.0 || samples == 0; sweeps++) {
+
+      for (c = 0; c < chains; c++) {
+         x = chain[c];
+         rng = streams + c*H;
+         Sweep ();
+         if (sweeps > burn) {
+            CountBlack (count, x);
+            samples ++;
+         }
+      }
+
+      t = WallTime ();
+      if (t > t1 + 5.0) {
+         printf (". ");
+         t1 = t;
+      }
+
+   }
+   x = chain[0];
+   rng = streams;
+
+   // Put the reconstruction in "best", and how sure it is in "sure".
+   sure = AllocateGrayImage ();
+   Marginals (count, samples, sure);
+
+   // Energy () works on "x".
+   CopyImage (best, x);
+   E = Energy ();
+
+   WritePBM ("BestReconstruction.pbm", best, "Posterior marginal reconstruction");
+   WriteCoordinates ("BestReconstruction", best);
+   WritePGM ("Uncertainty.pgm", sure, 255, "Certainty of each pixel (dark is uncertain)");
+
+   printf ("\n\n%d samples from %d chains averaged, %d sweeps of each in all.\n",
+           samples, chains, sweeps-1);
+   printf ("The reconstruction has energy %.3f.\n\n", E);
+   printf ("The reconstruction is in BestReconstruction.pbm, and how sure it is\n");
+   printf ("of each pixel in Uncertainty.pgm.\n");
+
+   Exit ();
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Put in "best" the color each pixel has in most of "samples" samples, given
+//    the counts of black (in a tie, its color in the degraded image). How sure
+//    that is, from 0 (half the samples each way) to 255 (all one way), is put
+//    in "sure" unless it is NULL.
+////////////////////////////////////////////////////////////////////////////////
+void Marginals (unsigned int *count, int samples, unsigned char *sure) {
+
+   int r, w, k, i, black;
+   unsigned int *n;
+   unsigned long long word;
+
+   for (r = 0; r < H; r++) {
+      for (w = 0; w < S-2; w++) {
+         n = count + ((long long) r*(S-2) + w) * 64;
+         word = 0;
+         for (k = 0; k < 64 && 64*w + k < W; k++) {
+            i = 2 * (int) n[k] - samples;
+            black = i > 0 || (i == 0 && (d[r*S + w] >> (63-k) & 1));
+            word |= (unsigned long long) black << (63-k);
+            if (sure != NULL) {
+               sure[r*(W+2) + 64*w + k] = (unsigned char) ((255LL * abs (i) + samples/2) / samples);
+            }
+         }
+         best[r*S + w] = word;
+      }
+   }
+
+   return;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Add one to count[64*(r*(S-2) + w) + k] for each black pixel of "image" in bit
+//    63-k of word w of row r.
+////////////////////////////////////////////////////////////////////////////////
+void CountBlack (unsigned int *count, unsigned long long *image) {
+
+   int r, w, k;
+   unsigned int *n;
+   unsigned long long word;
+
+   #pragma omp parallel for private(w, k, n, word) schedule(static)
+   for (r = 0; r < H; r++) {
+      for (w = 0; w < S-2; w++) {
+         word = image[r*S + w];
+         n = count + ((long long) r*(S-2) + w) * 64;
+         for (k = 0; k < 64; k++) {
+            n[k] += (word >> (63-k)) & 1;
+         }
+      }
+   }
+
+   return;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Put the lowest energy image in "x" and return its energy.
+// The energy lambda*B + (1-lambda)*D is a sum of terms for single pixels and
+//    for pairs of neighbors, and a pair costs more when its pixels differ
+//    than when they agree. Such an energy is the capacity of a cut in a graph
+//    with a node for each pixel plus a source and a sink: the pixels on the
+//    source's side of the cut are black, those on the sink's side white.
+//    - Each pixel is linked to each neighbor both ways with capacity lambda,
+//      which is paid for each boundary segment the cut makes.
+//    - A pixel is linked from the source with capacity equal to the energy
+//      of making it white, 1-lambda if it is black in the degraded image, and
+//      to the sink with capacity equal to the energy of making it black:
+//      1-lambda if it is white in the degraded image, plus lambda for each
+//      side on the edge of the image, next to the white border. Only the
+//      difference of the two matters, so just one of them is kept.
+//    The minimum cut, found by pushing the maximum flow through the graph
+//    (see MaxFlow ()), gives the lowest energy image.
+////////////////////////////////////////////////////////////////////////////////
+double GraphCut () {
+
+   int i, r, p, k, N, black, edges;
+   double E;
+
+   N = W*H;
+   cap = (double *) calloc (4*N, sizeof (double));
+   terminal = (double *) calloc (N, sizeof (double));
+   parent = (int *) calloc (N, sizeof (int));
+   stamp = (int *) calloc (N, sizeof (int));
+   dist = (int *) calloc (N, sizeof (int));
+   nextActive = (int *) calloc (N, sizeof (int));
+   orphans = (int *) calloc (N, sizeof (int));
+   tree = (char *) calloc (N, sizeof (char));
+   if (orphans == NULL || tree == NULL) {
+      printf ("There is not enough memory for a graph cut of a %d x %d image.\n", W, H);
+      Exit ();
+   }
+
+   for (r = 0; r < H; r++) {
+      for (i = 1; i <= W; i++) {
+         p = r*W + i-1;
+         for (k = 0; k < 4; k++) {
+            if (Neighbor (p, k) >= 0) cap[4*p+k] = lambda;
+         }
+         black = Pixel (d, i, H-r);
+         edges = (r == 0) + (r == H-1) + (i == 1) + (i == W);
+         terminal[p] = (1.0-lambda)*black - ((1.0-lambda)*(1-black) + lambda*edges);
+      }
+   }
+
+   MaxFlow ();
+
+   // The source's side of the cut is the pixels in the source's tree.
+   memset (x - S - 1, 0, (long long) (H+2) * S * sizeof (unsigned long long));
+   for (r = 0; r < H; r++) {
+      for (i = 1; i <= W; i++) {
+         if (tree[r*W + i-1] == SOURCE) FlipPixel (x, i, H-r);
+      }
+   }
+
+   free (cap);
+   free (terminal);
+   free (parent);
+   free (stamp);
+   free (dist);
+   free (nextActive);
+   free (orphans);
+   free (tree);
+
+   E = Energy ();
+
+   return E;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Push the maximum flow from the source to the sink, by the method of Boykov
+//    and Kolmogorov: grow a search tree from each terminal along links with
+//    capacity left until the trees touch, push flow along the path found,
+//    then mend the trees where the flow used up a link, and repeat. The trees
+//    are kept from one path to the next rather than grown afresh, which makes
+//    this fast on image grids. When the trees can grow no more, the pixels
+//    in the source's tree are those still reachable from the source.
+////////////////////////////////////////////////////////////////////////////////
+void MaxFlow () {
+
+   int p, q, k, a, b, ab, current, N;
+
+   N = W*H;
+   firstActive = lastActive = -1;
+   firstOrphan = nOrphans = 0;
+   now = 0;
+
+   // Each pixel linked to a terminal starts a tree of its own.
+   for (p = 0; p < N; p++) {
+      nextActive[p] = -1;
+      parent[p] = ORPHAN;
+      if (terminal[p] != 0) {
+         tree[p] = (terminal[p] > 0 ? SOURCE : SINK);
+         parent[p] = TERMINAL;
+         dist[p] = 1;
+         SetActive (p);
+      }
+   }
+
+   current = -1;
+   while (1) {
+
+      // Take the next active pixel, unless the last one can grow further.
+      p = current;
+      if (p >= 0) {
+         nextActive[p] = -1;
+         if (tree[p] == 0) p = -1;
+      }
+      if (p < 0) {
+         while ((p = firstActive) >= 0) {
+            firstActive = (nextActive[p] == p ? -1 : nextActive[p]);
+            if (firstActive < 0) lastActive = -1;
+            nextActive[p] = -1;
+            if (tree[p] != 0) break;
+         }
+         if (p < 0) break;
+      }
+
+      // Grow p's tree into its free neighbors until it touches the other
+      //    tree; then the link from "a" to "b" in direction "ab" joins them.
+      a = -1;
+      for (k = 0; k < 4; k++) {
+         q = Neighbor (p, k);
+         if (q < 0) continue;
+         if (tree[p] == SOURCE ? cap[4*p+k] <= 0 : cap[4*q+(k^1)] <= 0) continue;
+         if (tree[q] == 0) {
+            tree[q] = tree[p];
+            parent[q] = k^1;
+            stamp[q] = stamp[p];
+            dist[q] = dist[p] + 1;
+            SetActive (q);
+         } else if (tree[q] != tree[p]) {
+            if (tree[p] == SOURCE) {
+               a = p;  b = q;  ab = k;
+            } else {
+               a = q;  b = p;  ab = k^1;
+            }
+            break;
+         } else if (stamp[q] <= stamp[p] && dist[q] > dist[p]) {
+            // Shorten q's path to the terminal through p.
+            parent[q] = k^1;
+            stamp[q] = stamp[p];
+            dist[q] = dist[p] + 1;
+         }
+      }
+
+      now ++;
+
+      if (a < 0) {
+         current = -1;
+         continue;
+      }
+
+      // Keep p to grow further, push flow along the path, and then find new
+      //    parents for the pixels cut off from their trees.
+      nextActive[p] = p;
+      current = p;
+      Augment (a, b, ab);
+      while (nOrphans > 0) {
+         q = orphans[firstOrphan];
+         firstOrphan = (firstOrphan + 1) % N;
+         nOrphans --;
+         Adopt (q);
+      }
+
+   }
+
+   return;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The pixel next to pixel p in direction k (0 up, 1 down, 2 left, 3 right),
+//    or -1 if that is off the image. Directions k and k^1 are opposite.
+////////////////////////////////////////////////////////////////////////////////
+int Neighbor (int p, int k) {
+
+   switch (k) {
+      case 0:  return (p >= W ? p - W : -1);
+      case 1:  return (p < (H-1)*W ? p + W : -1);
+      case 2:  return (p % W > 0 ? p - 1 : -1);
+      default: return (p % W < W-1 ? p + 1 : -1);
+   }
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Push as much flow as possible from the source, down the source's tree to
+//    pixel a, over the link from a in direction ab to pixel b, and down the
+//    sink's tree to the sink. Pixels whose links to their parents are used
+//    up become orphans.
+////////////////////////////////////////////////////////////////////////////////
+void Augment (int a, int b, int ab) {
+
+   int p, q, k;
+   double f;
+
+   // The flow is limited by the link with the least capacity left.
+   f = cap[4*a+ab];
+   for (p = a; parent[p] != TERMINAL; p = Neighbor (p, parent[p])) {
+      q = Neighbor (p, parent[p]);
+      if (cap[4*q + (parent[p]^1)] < f) f = cap[4*q + (parent[p]^1)];
+   }
+   if (terminal[p] < f) f = terminal[p];
+   for (p = b; parent[p] != TERMINAL; p = Neighbor (p, parent[p])) {
+      if (cap[4*p + parent[p]] < f) f = cap[4*p + parent[p]];
+   }
+   if (-terminal[p] < f) f = -terminal[p];
+
+   // Push it. Capacities within a billionth of 0 are taken to be used up, so
+   //    that rounding does not leave links with next to nothing in them.
+   cap[4*a+ab] -= f;
+   cap[4*b+(ab^1)] += f;
+   for (p = a; parent[p] != TERMINAL; p = q) {
+      k = parent[p];
+      q = Neighbor (p, k);
+      cap[4*p+k] += f;
+      cap[4*q+(k^1)] -= f;
+      if (cap[4*q+(k^1)] < 1e-9) {
+         cap[4*q+(k^1)] = 0;
+         SetOrphan (p);
+      }
+   }
+   terminal[p] -= f;
+   if (terminal[p] < 1e-9) {
+      terminal[p] = 0;
+      SetOrphan (p);
+   }
+   for (p = b; parent[p] != TERMINAL; p = q) {
+      k = parent[p];
+      q = Neighbor (p, k);
+      cap[4*p+k] -= f;
+      cap[4*q+(k^1)] += f;
+      if (cap[4*p+k] < 1e-9) {
+         cap[4*p+k] = 0;
+         SetOrphan (p);
+      }
+   }
+   terminal[p] += f;
+   if (terminal[p] > -1e-9) {
+      terminal[p] = 0;
+      SetOrphan (p);
+   }
+
+   return;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Find a new parent in its tree for orphan p: the neighbor nearest a terminal
+//    of those it has capacity left to (or from, in the source's tree) that
+//    are still connected to the terminal. If there is none, p leaves the tree
+//    and its children become orphans in turn.
+////////////////////////////////////////////////////////////////////////////////
+void Adopt (int p) {
+
+   int q, r, k, best_k, n, n_min;
+
+   best_k = -1;
+   n_min = W*H + 1;
+
+   for (k = 0; k < 4; k++) {
+      q = Neighbor (p, k);
+      if (q < 0 || tree[q] != tree[p]) continue;
+      if (tree[p] == SOURCE ? cap[4*q+(k^1)] <= 0 : cap[4*p+k] <= 0) continue;
+
+      // Follow q's parents to the terminal, counting the links, unless the
+      //    path is known to be sound from a pixel found since the last flow
+      //    was pushed or it ends at an orphan.
+      n = 0;
+      for (r = q; ; r = Neighbor (r, parent[r])) {
+         if (stamp[r] == now) {
+            n += dist[r];
+            break;
+         }
+         n ++;
+         if (parent[r] == TERMINAL) {
+            stamp[r] = now;
+            dist[r] = 1;
+            break;
+         }
+         if (parent[r] == ORPHAN) {
+            n = W*H + 1;
+            break;
+         }
+      }
+
+      if (n <= W*H) {
+         if (n < n_min) {
+            best_k = k;
+            n_min = n;
+         }
+         // Note the distances along the path for the next search.
+         for (r = q; stamp[r] != now; r = Neighbor (r, parent[r])) {
+            stamp[r] = now;
+            dist[r] = n--;
+         }
+      }
+   }
+
+   if (best_k >= 0) {
+      parent[p] = best_k;
+      stamp[p] = now;
+      dist[p] = n_min + 1;
+      return;
+   }
+
+   // No parent: p's neighbors in the tree may grow back into it, and its
+   //    children are orphans.
+   for (k = 0; k < 4; k++) {
+      q = Neighbor (p, k);
+      if (q < 0 || tree[q] != tree[p]) continue;
+      if (tree[p] == SOURCE ? cap[4*q+(k^1)] > 0 : cap[4*p+k] > 0) SetActive (q);
+      if (parent[q] == (k^1)) SetOrphan (q);
+   }
+   tree[p] = 0;
+
+   return;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Add pixel p to the end of the list of active pixels, if it is not in it.
+////////////////////////////////////////////////////////////////////////////////
+void SetActive (int p) {
+
+   if (nextActive[p] >= 0) return;
+
+   if (lastActive >= 0) {
+      nextActive[lastActive] = p;
+   } else {
+      firstActive = p;
+   }
+   lastActive = p;
+   nextActive[p] = p;
+
+   return;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Pixel p has lost its parent; add it to the orphan queue.
+////////////////////////////////////////////////////////////////////////////////
+void SetOrphan (int p) {
+
+   parent[p] = ORPHAN;
+   orphans[(firstOrphan + nOrphans) % (W*H)] = p;
+   nOrphans ++;
+
+   return;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Reconstruct a gray-scale image via Metropolis, as Metropolis () does for
+//    black and white ones. A proposed transition changes a pixel to one of
+//    the other q-1 levels at random.
+////////////////////////////////////////////////////////////////////////////////
+void GrayMetropolis () {
+
+   int i0, j0, r, level, AcceptTransition, mode;
+   double U, p, T, E, DeltaE, t, t1, n, NextReport;
+
+   // Get the kind of proposal.
+   mode = GetInteger ("\nChange one random pixel at a time (0) or sweep the checkerboard (1)?... ");
+
+   // Get the temperature.
+   T = GetDouble ("\nWhat is the temperature (best about 0.1)?... ");
+   Thresholds (T, H);
+
+   E_min = E = GrayEnergy ();
+
+   // Report next image at Markov chain period number "NextReport".
+   NextReport = 1000;
+   n = 0;
+
+   printf ("\nI'll be done in 60 seconds. ");
+   t = t1 = WallTime ();
+
+   // Run the Markov chain for 60 seconds.
+   while (t < 60.0) {
+
+      // Checkerboard sweeps: each one offers a change to every pixel.
+      if (mode == 1) {
+         E += GraySweep ();
+         if (E < E_min) {
+            E_min = E;
+            CopyGray (gx, gbest);
+         }
+         n += (double) W*H;
+      }
+
+      else {
+
+         n ++;
+
+         // Propose a new level for pixel (i0,j0), in place r of the image.
+         i0 = RandomInteger (1, W);
+         j0 = RandomInteger (1, H);
+         r = (H-j0)*(W+2) + i0-1;
+         level = RandomInteger (0, q-2);
+         if (level >= gx[r]) level ++;
+
+         DeltaE = GrayDeltaEnergy (r, level);
+
+         AcceptTransition = 0;
+         if (DeltaE <= 0) {
+            AcceptTransition = 1;
+         } else if (T > 0) {
+            p = exp (-DeltaE / T);
+            U = MTUniform ();
+            if (U <= p) {
+               AcceptTransition = 1;
+            }
+         }
+
+         if (AcceptTransition) {
+            gx[r] = level;
+            Journal (r, level);
+            E += DeltaE;
+            if (E < E_min) {
+               E_min = E;
+               NewBest ();
+            }
+         }
+
+      }
+
+      // Periodically report the reconstructed image to an output file.
+      if (n >= NextReport && NextReport <= 100000000) {
+         ReportImage ();
+         NextReport *= 10;
+      }
+
+      // Every five seconds indicate that it's still thinking.
+      t = WallTime ();
+      if (t > t1 + 5.0) {
+         printf (". ");
+         t1 = t;
+      }
+
+   }
+
+   // Report any images not yet reported, then the lowest energy reconstruction.
+   while (NextReport <= 100000000) {
+      ReportImage ();
+      NextReport *= 10;
+   }
+   BestImage ();
+   ReportImage ();
+
+   // Finish up.
+   printf ("\n\n");
+   printf ("%.1f million Markov chain steps completed in 60 seconds.\n\n", n/1000000.0);
+   printf ("The reconstruction process is in 1000.pgm, ..., BestReconstruction.pgm.\n");
+
+   Exit ();
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Copy gray-scale image "from", with its border, into image "to".
+////////////////////////////////////////////////////////////////////////////////
+void CopyGray (unsigned char *from, unsigned char *to) {
+
+   memcpy (to - (W+2) - 1, from - (W+2) - 1, (long long) (H+2) * (W+2));
+
+   return;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Compute the energy of gray-scale image "gx": B counts the neighbors, and
+//    the border pixels next to the image, at different levels.
+////////////////////////////////////////////////////////////////////////////////
+double GrayEnergy () {
+
+   int r, c, s;
+   double D = 0, B = 0;
+
+   s = W+2;
+   for (r = -1; r < H; r++) {
+      for (c = -1; c <= W; c++) {
+         // The pixel to the right, and the pixel below.
+         if (r >= 0 && c < W) B += (gx[r*s + c] != gx[r*s + c+1]);
+         if (c >= 0 && c < W) B += (gx[r*s + c] != gx[(r+1)*s + c]);
+         if (r >= 0 && c >= 0 && c < W) D += (gx[r*s + c] != gd[r*s + c]);
+      }
+   }
+
+   return lambda*B + (1.0-lambda)*D;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The change in energy when the pixel in place r of "gx" is changed to
+//    "level".
+////////////////////////////////////////////////////////////////////////////////
+double GrayDeltaEnergy (int r, int level) {
+
+   int c, a, b, s;
+
+   s = W+2;
+   c = gx[r];
+
+   b =   (level != gx[r-s]) - (c != gx[r-s])  // northern neighbor
+       + (level != gx[r+1]) - (c != gx[r+1])  // eastern neighbor
+       + (level != gx[r+s]) - (c != gx[r+s])  // southern neighbor
+       + (level != gx[r-1]) - (c != gx[r-1]); // western neighbor
+   a = (level != gd[r]) - (c != gd[r]);
+
+   return GrayChange[b+4][a+1];
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// One checkerboard sweep of the gray-scale image at the temperature given to
+//    Thresholds (), as Sweep () does for black and white ones. Each pixel of
+//    one color, then the other, is offered a random new level; one random
+//    64-bit number gives both the level and the 32-bit number compared with
+//    the acceptance threshold.
+// The pixels of one color in a row are taken GRAY_BLOCK at a time. Their
+//    random numbers are drawn first, since each row has one stream. Then, in
+//    a loop the compiler turns into vector instructions on bytes, every
+//    pixel of the stretch of row they cover gets its proposed level and the
+//    place 3*(b+4) + a+1 of its change in GrayChange and GrayThreshold. The
+//    pixels of the other color come along only to keep the loads contiguous,
+//    and are ignored. No pixel of the block depends on another, since all
+//    their neighbors are of the other color. Each is then accepted or not by
+//    a table lookup. The result is the same as offering the flips one by one.
+// Returns the change in energy.
+////////////////////////////////////////////////////////////////////////////////
+double GraySweep () {
+
+   int r, c, k, n, s, color, accept;
+   unsigned int V[GRAY_BLOCK];
+   unsigned char *row, *deg, level[2*GRAY_BLOCK], place[2*GRAY_BLOCK];
+   unsigned long long R, *threshold;
+   double *change, DeltaE = 0;
+
+   s = W+2;
+   threshold = GrayThreshold[0];
+   change = GrayChange[0];
+
+   for (color = 0; color <= 1; color++) {
+
+      #pragma omp parallel for private(c, k, n, accept, row, deg, R, V, level, place) reduction(+:DeltaE) schedule(static)
+      for (r = 0; r < H; r++) {
+
+         row = gx + (long long) r*s;
+         deg = gd + (long long) r*s;
+
+         for (c = (r + color) % 2; c < W; c += 2*GRAY_BLOCK) {
+
+            // The number of pixels of this color left in the row, up to
+            //    GRAY_BLOCK; they are row[c], row[c+2], ..., row[c+2n-2].
+            n = (W - c + 1) / 2;
+            if (n > GRAY_BLOCK) n = GRAY_BLOCK;
+
+            // A new level for each, from 0 to q-2 for now, and the number to
+            //    compare with its threshold.
+            for (k = 0; k < n; k++) {
+               R = RandomBits (rng + r);
+               level[2*k] = (unsigned char) (((R >> 32) * (q-1)) >> 32);
+               level[2*k+1] = 0;
+               V[k] = (unsigned int) R;
+            }
+
+            #pragma omp simd
+            for (k = 0; k < 2*n-1; k++) {
+               unsigned char *p = row + c + k, old = p[0], lv, b, a;
+               lv = level[k] + (level[k] >= old);
+               b = 4 + (lv != p[-s]) - (old != p[-s])
+                     + (lv != p[1])  - (old != p[1])
+                     + (lv != p[s])  - (old != p[s])
+                     + (lv != p[-1]) - (old != p[-1]);
+               a = 1 + (lv != deg[c+k]) - (old != deg[c+k]);
+               level[k] = lv;
+               place[k] = 3*b + a;
+            }
+
+            // Accepted or not at random, so without branches.
+            for (k = 0; k < n; k++) {
+               accept = (V[k] < threshold[place[2*k]]);
+               row[c+2*k] = (accept ? level[2*k] : row[c+2*k]);
+               DeltaE += (accept ? change[place[2*k]] : 0);
+            }
+
+         }
+
+      }
+
+   }
+
+   return DeltaE;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Compare the ways of reconstructing images, to choose between them. Each
+//    original image (a PBM file) named is degraded for 100, 200, 500, 1000,
+//    and 2000 years, several times over. Each degraded image is reconstructed
+//    exactly with a graph cut, and then by each Markov chain: single pixel
+//    flips (mode 0), checkerboard sweeps (1), active set flips (3), posterior
+//    marginals (4, one chain), and sweeps with cluster flips (5), all at the
+//    same temperature and all started from the degraded image.
+// At 0.1, 0.2, 0.5, 1, 2, 5, ... seconds into each run, the clock is stopped
+//    to count the pixels of the reconstruction so far (the best image, or for
+//    posterior marginals the majority of the samples) that differ from the
+//    original, and to see how far its energy is above the lowest.
+// Averages are printed as tables, and each measurement goes to Benchmark.csv.
+////////////////////////////////////////////////////////////////////////////////
+void Benchmark (int files, char *names[]) {
+
+   int f, y, run, m, k, c, type, maxval, runs, checks, sweeps, samples,
+       years[5] = {100, 200, 500, 1000, 2000},
+       modes[5] = {0, 1, 3, 4, 5};
+   const char *modeName[6] = {"single pixel", "sweeps", "graph cut",
+                              "active set", "marginals", "clusters"};
+   unsigned long long *original, *image;
+   unsigned int *count;
+   double T, seconds, E, E_exact, DeltaE, t0, elapsed, wrong, gap,
+          when[20], wrongSum[5][20], gapSum[5][20], wrongExact, timeExact,
+          step[3] = {1, 2, 5};
+   char comment[100];
+   FILE *fp, *csv;
+
+   runs = GetInteger ("\nHow many times should each image be degraded for each number"
+                      "\nof years (e.g., 5)?... ");
+   seconds = GetDouble ("\nHow many seconds should each Markov chain run (e.g., 10)?... ");
+   T = GetDouble ("\nWhat is the temperature (best about 0.1)?... ");
+
+   // Seed the random number generator now, with the other questions.
+   MTUniform ();
+
+   // The times to stop and measure: 0.1, 0.2, 0.5, 1, ... seconds, and the end.
+   checks = 0;
+   for (k = 0; checks < 19; k++) {
+      t0 = step[k%3] * 0.1 * pow (10, k/3);
+      if (t0 >= seconds) break;
+      when[checks++] = t0;
+   }
+   when[checks++] = seconds;
+
+   csv = fopen ("Benchmark.csv", "w");
+   if (csv == NULL) {
+      printf ("I cannot write Benchmark.csv.\n");
+      Exit ();
+   }
+   fprintf (csv, "image,years,run,method,seconds,wrong,gap\n");
+
+   for (f = 0; f < files; f++) {
+
+      fp = OpenImage (names[f], &type, &maxval, comment);
+      if (fp == NULL || type != 4) {
+         printf ("\n%s is not a PBM file.\n", names[f]);
+         if (fp != NULL) fclose (fp);
+         continue;
+      }
+      original = ReadPBM (fp);
+      d = AllocateImage ();
+      AllocateImageMemory ();
+      count = (unsigned int *) calloc ((long long) H * 64 * (S-2), sizeof (unsigned int));
+
+      for (y = 0; y < 5; y++) {
+
+         wrongExact = timeExact = 0;
+         for (m = 0; m < 5; m++) {
+            for (k = 0; k < checks; k++) {
+               wrongSum[m][k] = gapSum[m][k] = 0;
+            }
+         }
+
+         for (run = 1; run <= runs; run++) {
+
+            Degrade (original, years[y]);
+            sprintf (comment, "%d years", years[y]);
+            printf ("\n");
+            SetLambda (comment);
+
+            // The lowest energy image, to measure the others by.
+            CopyImage (d, x);
+            t0 = WallTime ();
+            E_exact = GraphCut ();
+            t0 = WallTime () - t0;
+            wrong = Differences (x, original);
+            wrongExact += wrong;
+            timeExact += t0;
+            fprintf (csv, "%s,%d,%d,%s,%.3f,%.0f,0\n",
+                     names[f], years[y], run, modeName[2], t0, wrong);
+
+            for (m = 0; m < 5; m++) {
+
+               CopyImage (d, x);
+               CopyImage (d, best);
+               journalLength = bestLength = 0;
+               E = E_min = Energy ();
+               if (modes[m] == 1 || modes[m] >= 4) Thresholds (T, H);
+               if (modes[m] == 3) ActiveSet ();
+               memset (count, 0, (long long) H * 64 * (S-2) * sizeof (unsigned int));
+               sweeps = samples = 0;
+
+               elapsed = 0;
+               for (k = 0; k < checks; k++) {
+
+                  // Run the chain to the next time to measure.
+                  t0 = WallTime ();
+                  while (elapsed + WallTime () - t0 < when[k]) {
+
+                     if (modes[m] == 1 || modes[m] == 5) {
+                        E += Sweep ();
+                        if (modes[m] == 5) E += ClusterSweep (T);
+                        if (E < E_min) {
+                           E_min = E;
+                           CopyImage (x, best);
+                        }
+                     }
+
+                     // Samples count after 20 sweeps.
+                     else if (modes[m] == 4) {
+                        Sweep ();
+                        if (++sweeps > 20) {
+                           CountBlack (count, x);
+                           samples ++;
+                        }
+                     }
+
+                     else for (c = 0; c < 1000; c++) {
+                        if (Step (modes[m], T, &DeltaE)) {
+                           E += DeltaE;
+                           if (E < E_min) {
+                              E_min = E;
+                              NewBest ();
+                           }
+                        }
+                     }
+
+                  }
+                  elapsed += WallTime () - t0;
+
+                  // Measure the reconstruction so far. Energy () works on "x".
+                  if (modes[m] == 4) {
+                     if (samples > 0) {
+                        Marginals (count, samples, NULL);
+                     } else {
+                        CopyImage (x, best);
+                     }
+                  } else {
+                     BestImage ();
+                  }
+                  wrong = Differences (best, original);
+                  image = x;
+                  x = best;
+                  gap = Energy () - E_exact;
+                  x = image;
+                  wrongSum[m][k] += wrong;
+                  gapSum[m][k] += gap;
+                  fprintf (csv, "%s,%d,%d,%s,%.3f,%.0f,%.3f\n",
+                           names[f], years[y], run, modeName[modes[m]], when[k], wrong, gap);
+
+               }
+
+            }
+
+         }
+
+         // Report the averages.
+         printf ("\n%s degraded %d years, average of %d: the pixels wrong, and the\n",
+                 names[f], years[y], runs);
+         printf ("energy above the lowest, after\n%-13s", "");
+         for (k = 0; k < checks; k++) {
+            printf ("%9.1f s", when[k]);
+         }
+         printf ("\n%-13s%11.0f in %.2f s\n", modeName[2], wrongExact/runs, timeExact/runs);
+         for (m = 0; m < 5; m++) {
+            printf ("%-13s", modeName[modes[m]]);
+            for (k = 0; k < checks; k++) {
+               printf ("%11.0f", wrongSum[m][k]/runs);
+            }
+            printf ("\n%-13s", "");
+            for (k = 0; k < checks; k++) {
+               printf ("%11.1f", gapSum[m][k]/runs);
+            }
+            printf ("\n");
+         }
+         fflush (csv);
+
+      }
+
+      free (original - S - 1);
+      free (d - S - 1);
+      free (x - S - 1);
+      free (best - S - 1);
+      free (journal);
+      free (count);
+
+   }
+
+   fclose (csv);
+
+   printf ("\nEach measurement is in Benchmark.csv.\n");
+
+   Exit ();
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Put in "d" the image "original" degraded for "years" years, in the same way
+//    as ImageDegradation.cpp does it.
+////////////////////////////////////////////////////////////////////////////////
+void Degrade (unsigned long long *original, int years) {
+
+   long long k, N;
+   double flips, p, skip, t;
+
+   CopyImage (original, d);
+
+   N = (long long) W * H;
+   flips = N / 1000.0 * years;
+
+   // For big images, pick the flipped pixels directly (see
+   //    ImageDegradation.cpp).
+   if (N > 40000) {
+      p = 0.5 * (1.0 - pow (1.0 - 2.0/N, flips));
+      k = -1;
+      while (1) {
+         skip = log (MTUniform ()) / log1p (-p);
+         if (k + 1 + skip >= N) break;
+         k += 1 + (long long) skip;
+         FlipPixel (d, k % W + 1, H - k / W);
+      }
+      flips = 0;
+   }
+
+   for (t = 1; t <= flips; t++) {
+      FlipPixel (d, RandomInteger (1, W), RandomInteger (1, H));
+   }
+
+   return;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The number of pixels that differ between images "a" and "b".
+////////////////////////////////////////////////////////////////////////////////
+int Differences (unsigned long long *a, unsigned long long *b) {
+
+   int r, w, n = 0;
+
+   for (r = 0; r < H; r++) {
+      for (w = 0; w < S-2; w++) {
+         n += __builtin_popcountll (a[r*S + w] ^ b[r*S + w]);
+      }
+   }
+
+   return n;
+
+}
@@ -25,21 +25,70 @@ SOFTWARE.
 ////////////////////////////////////////////////////////////////////////////////
 // This code looks for near-optimal TSP routes using the Metropolis
 // algorithm as described in Section 17. The sites toured are drill sites
-// on a circuit board.
+// on a circuit board, unless a file of sites is named on the command line:
+// a TSPLIB file (e.g., pr1002.tsp) or a CSV file (e.g., stops.csv).
 // Look at www.math.uwaterloo.ca/tsp for images and information on TSP.
 ////////////////////////////////////////////////////////////////////////////////
 
 // Global variables.
 int K, n_min, *c, *best, *temp, i0, j0;
-double *X, *Y, **d, E, E_min;
+double *X, *Y, E, E_min;
+
+// The distances between sites. For up to MATRIX_SITES sites they are worked
+//    out once and looked up in D, a K+1 x K+1 matrix of floats stored row
+//    after row in one block, so that D[i*(K+1) + j] is the distance from site
+//    i to site j. For more sites the matrix would not fit in memory (it would
+//    take 10 GB for 50,000 sites), so D is NULL and each distance is worked
+//    out from the coordinates when it is needed.
+#define MATRIX_SITES 4000
+float *D;
+
+// How the distance between two sites is worked out: for the drill sites,
+//    straight-line distance in centimeters from coordinates in millimeters;
+//    for a CSV file, straight-line distance; and for a TSPLIB file, as its
+//    EDGE_WEIGHT_TYPE says: straight-line distance rounded (EUC_2D) or rounded
+//    up (CEIL_2D), the "pseudo-Euclidean" distance of ATT, the distance in
+//    kilometers over the earth from latitudes and longitudes (GEO), or just
+//    given in the file (EXPLICIT, with every distance in D).
+#define DRILL 0
+#define PLAIN 1
+#define EUC_2D 2
+#define CEIL_2D 3
+#define ATT 4
+#define GEO 5
+#define EXPLICIT 6
+int metric = DRILL;
+
+// The file the sites were read from (NULL for the drill sites), and the length
+//    of the shortest known route through them (0 if not known).
+const char *instance;
+double E_opt;
+
+// The reversals done since best[] was last brought up to date, as pairs
+//    (i0,j0), and how many of them lead to the best route. "journalCost" adds
+//    up their lengths; the journal is full (journalLength = -1) when applying
+//    it would take longer than copying a route, and then best[] is brought up
+//    to date and copied whole at the next new best route.
+int *journal, journalLength, bestLength, journalCost;
 
 // These functions are found below.
 void    InitializeArrays ();
+void    AllocateArrays ();
+void    ReadSites (const char *, const char *);
+void    ReadTSPLIB (const char *);
+void    ReadCSV (const char *);
+void    DistanceMatrix ();
+double  ReadTour (const char *);
 void    RandomRoute ();
 void    ReportRoute ();
 void    Proposal ();
-void    Reverse ();
+void    Reverse (int *, int, int);
+void    Journal ();
+void    NewBest ();
+void    BestRoute ();
 void    Metropolis ();
+double  Distance (int, int);
+double  SiteDistance (int, int);
 
 // These functions are in common to all applications.
 #include "MetropolisFunctions.h"
@@ -47,7 +96,19 @@ void    Metropolis ();
 ////////////////////////////////////////////////////////////////////////////////
 // Main program.
 ////////////////////////////////////////////////////////////////////////////////
-int main() {
+int main (int argc, char *argv[]) {
+
+   // Tour the sites in the file named on the command line, if any, e.g.
+   //    RouteOptimization pr1002.tsp
+   //    and compare the routes found with the route in the second file named,
+   //    if any, e.g.
+   //    RouteOptimization pr1002.tsp pr1002.opt.tour
+   //    (for a TSPLIB file, with a route in the same place with the same name
+   //    ending .opt.tour if it is there).
+   instance = (argc > 1 ? argv[1] : NULL);
+   if (instance != NULL) {
+      ReadSites (instance, argc > 2 ? argv[2] : NULL);
+   }
 
    // Generate a random initial route through the sites.
    RandomRoute ();
@@ -66,7 +127,7 @@ int main() {
 void Metropolis () {
 
    double T, DeltaE, p, U, t, t1;
-   int k, n, AcceptTransition, NextReport;
+   int n, AcceptTransition, NextReport;
 
 
 
@@ -100,8 +161,8 @@ void Metropolis () {
 
       // Compute the change in energy associated with reversing that portion
       //   of the route.
-      DeltaE =  d [c[i0-1]] [c[j0]] + d [c[i0]] [c[j0+1]]
-              - d [c[i0-1]] [c[i0]] - d [c[j0]] [c[j0+1]];
+      DeltaE =  Distance (c[i0-1], c[j0]) + Distance (c[i0], c[j0+1])
+              - Distance (c[i0-1], c[i0]) - Distance (c[j0], c[j0+1]);
 
       // See if the proposed transition is accepted.
       AcceptTransition = 0;
@@ -122,19 +183,21 @@ void Metropolis () {
       //    route (in best[*]) and the new minimal energy (Emin).
       if (AcceptTransition) {
 
-         // Reverse the part of route "c" from i0 to j0.
-         Reverse ();
+         // Reverse the part of route "c" from i0 to j0, and note it in the
+         //    journal.
+         Reverse (c, i0, j0);
+         Journal ();
 
          // Update the length of the current route (the route's "energy").
          E += DeltaE;
 
          // Record data for the best-route-so-far, if appropriate.
+         //    Only its place in the journal is noted; it is put together
+         //    when needed.
          if (E < E_min) {
             E_min = E;
             n_min = n;
-            for (k = 1; k <= K+1; k++) {
-               best[k] = c[k];
-            }
+            NewBest ();
          }
 
       } // End of "if" statement.
@@ -152,15 +215,29 @@ void Metropolis () {
 
    } // This ends the Markov chain simulation loop.
 
-   // Report the best route found throughout the Markov chain.
+   // Report any routes not yet reported, then the best route found
+   //    throughout the Markov chain.
+   while (NextReport <= 100000000) {
+      ReportRoute ();
+      NextReport *= 10;
+   }
    E = E_min;
+   BestRoute ();
    ReportRoute ();
 
    // Finish up; report best-found route length to the screen.
    printf ("\n\n");
    printf ("%.1f million Markov chain steps completed in 60 seconds.\n\n", n/1000000.0);
    printf ("Shortest route was number %d with length %.3f\n\n", n_min, E_min);
-   printf ("View the solution with ShowRoutes.tex using Plain TeX.\n");
+   if (E_opt > 0) {
+      printf ("The shortest known route has length %.3f; this one is %.2f%% longer.\n\n",
+              E_opt, 100.0 * (E_min - E_opt) / E_opt);
+   }
+   if (instance == NULL) {
+      printf ("View the solution with ShowRoutes.tex using Plain TeX.\n");
+   } else {
+      printf ("The route is in BestRoute.tour.\n");
+   }
 
 }
 
@@ -200,22 +277,85 @@ void Proposal () {
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// This function reverses the part of route c from i0 to j0.
+// This function reverses the part of route r from i to j.
 ////////////////////////////////////////////////////////////////////////////////
-void Reverse () {
+void Reverse (int *r, int i, int j) {
 
    int k;
 
    // Make a copy of the part of the route to be reversed.
-   for (k = i0; k <= j0; k++) {
-      temp[k] = c[k];
+   for (k = i; k <= j; k++) {
+      temp[k] = r[k];
+   }
+
+   // Now reverse it. Observe that when k = i we get r[i] = temp[j],
+   //    and when k = j we get r[j] = temp[i].
+   for (k = i; k <= j; k++) {
+      r[k] = temp[i+j-k];
+   }
+
+   return;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Note in the journal that the part of route c from i0 to j0 was reversed.
+////////////////////////////////////////////////////////////////////////////////
+void Journal () {
+
+   if (journalLength < 0) return;
+
+   if (journalCost + j0 - i0 + 1 <= K) {
+      journal[2*journalLength] = i0;
+      journal[2*journalLength+1] = j0;
+      journalLength ++;
+      journalCost += j0 - i0 + 1;
+   }
+
+   // The journal is full: bring best[] up to date and stop journaling until
+   //    the next new best route.
+   else {
+      BestRoute ();
+   }
+
+   return;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Route c is the new best route.
+////////////////////////////////////////////////////////////////////////////////
+void NewBest () {
+
+   int k;
+
+   // If the journal has been stopped, copy the route and start it again.
+   if (journalLength < 0) {
+      for (k = 1; k <= K+1; k++) {
+         best[k] = c[k];
+      }
+      journalLength = journalCost = 0;
    }
 
-   // Now reverse it. Observe that when k = i0 we get c[i0] = temp[j0],
-   //    and when k = j0 we get c[j0] = temp[i0].
-   for (k = i0; k <= j0; k++) {
-      c[k] = temp[i0+j0-k];
+   bestLength = journalLength;
+
+   return;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Bring best[] up to date by applying the reversals in the journal that lead
+//    to it. The rest of the journal is then of no use, so it is stopped.
+////////////////////////////////////////////////////////////////////////////////
+void BestRoute () {
+
+   int k;
+
+   for (k = 0; k < bestLength; k++) {
+      Reverse (best, journal[2*k], journal[2*k+1]);
    }
+   bestLength = 0;
+   journalLength = -1;
 
    return;
 
@@ -227,8 +367,7 @@ void Reverse () {
 ////////////////////////////////////////////////////////////////////////////////
 void InitializeArrays () {
 
-   int i, j;
-   double dx, dy;
+   int i;
 
    // X and Y coordinates in millimeters of the 183 drill sites.
    double X0[] =
@@ -265,15 +404,7 @@ void InitializeArrays () {
    K = 183;
 
    // Allocate additional necessary array space.
-   X = (double *) calloc (K+1, sizeof (double));
-   Y = (double *) calloc (K+1, sizeof (double));
-   d = (double **) calloc (K+1, sizeof (double *));
-   for (i = 1; i <= K; i++) {
-      d[i] = (double *) calloc (K+1, sizeof (double));
-   }
-   c    = (int *) calloc (K+3, sizeof (int));
-   best = (int *) calloc (K+3, sizeof (int));
-   temp = (int *) calloc (K+3, sizeof (int));
+   AllocateArrays ();
 
    // Copy the above coordinates to the global variables. Perturb them slightly
    //   to avoid distance ties. (The coordinates are currently integer-valued.)
@@ -282,21 +413,389 @@ void InitializeArrays () {
       Y[i] = Y0[i] + 0.001 * MTUniform();
    }
 
-   // Compute the distance between each pair of sites in centimeters (the data
-   //    is in millimeters, so divide by 10).
+   // Compute the distance between each pair of sites.
+   DistanceMatrix ();
+
+   return;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Allocate array space for "K" sites.
+////////////////////////////////////////////////////////////////////////////////
+void AllocateArrays () {
+
+   X = (double *) calloc (K+1, sizeof (double));
+   Y = (double *) calloc (K+1, sizeof (double));
+   c    = (int *) calloc (K+3, sizeof (int));
+   best = (int *) calloc (K+3, sizeof (int));
+   temp = (int *) calloc (K+3, sizeof (int));
+
+   // Each reversal in the journal has length at least 2.
+   journal = (int *) calloc (K+2, sizeof (int));
+
+   if (X == NULL || Y == NULL || c == NULL || best == NULL || temp == NULL
+       || journal == NULL) {
+      printf ("There is not enough memory for %d sites.\n", K);
+      Exit ();
+   }
+
+   return;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Compute the distance between each pair of sites, if there are not too many
+//    (see D above). A file of distances has filled in D already.
+////////////////////////////////////////////////////////////////////////////////
+void DistanceMatrix () {
+
+   int i, j;
+
+   if (metric == EXPLICIT || K > MATRIX_SITES) return;
+
+   D = (float *) calloc ((long long) (K+1) * (K+1), sizeof (float));
+   if (D == NULL) {
+      printf ("There is not enough memory for the distances.\n");
+      Exit ();
+   }
    for (i = 1; i <= K; i++) {
       for (j = 1; j <= K; j++) {
-         dx = (X[i] - X[j]) / 10.0;
-         dy = (Y[i] - Y[j]) / 10.0;
-         d[i][j] = sqrt(dx*dx + dy*dy);
+         D[(long long) i*(K+1) + j] = SiteDistance (i, j);
+      }
+   }
+
+   return;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The distance from site i to site j, from the matrix if there is one.
+////////////////////////////////////////////////////////////////////////////////
+double Distance (int i, int j) {
+
+   if (D != NULL) {
+      return D[(long long) i*(K+1) + j];
+   }
+
+   return SiteDistance (i, j);
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Compute the distance from site i to site j, as "metric" says. The TSPLIB
+//    distances are worked out just as TSPLIB defines them, so that route
+//    lengths agree with those published.
+////////////////////////////////////////////////////////////////////////////////
+double SiteDistance (int i, int j) {
+
+   double dx, dy, r, q1, q2, q3;
+
+   dx = X[i] - X[j];
+   dy = Y[i] - Y[j];
+
+   switch (metric) {
+
+      // The drill site coordinates are in millimeters, so divide by 10 to get
+      //    centimeters.
+      case DRILL:
+         return sqrt (dx*dx + dy*dy) / 10.0;
+
+      case PLAIN:
+         return sqrt (dx*dx + dy*dy);
+
+      case EUC_2D:
+         return floor (sqrt (dx*dx + dy*dy) + 0.5);
+
+      case CEIL_2D:
+         return ceil (sqrt (dx*dx + dy*dy));
+
+      case ATT:
+         r = sqrt ((dx*dx + dy*dy) / 10.0);
+         return (floor (r + 0.5) < r ? floor (r + 0.5) + 1 : floor (r + 0.5));
+
+      // X and Y have been made latitude and longitude in radians.
+      case GEO:
+         q1 = cos (Y[i] - Y[j]);
+         q2 = cos (X[i] - X[j]);
+         q3 = cos (X[i] + X[j]);
+         return (int) (6378.388 * acos (0.5 * ((1.0+q1)*q2 - (1.0-q1)*q3)) + 1.0);
+
+   }
+
+   return 0;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Read the sites from the file "name": a TSPLIB file, or if its name ends in
+//    .csv a CSV file. Then read the route in the file "tour", or for a TSPLIB
+//    file with no "tour" given, the route in the .opt.tour file of the same
+//    name if there is one, to compare routes with.
+////////////////////////////////////////////////////////////////////////////////
+void ReadSites (const char *name, const char *tour) {
+
+   char optTour[1000];
+   int k, csv;
+
+   k = strlen (name);
+   csv = (k > 4 && (strcmp (name + k-4, ".csv") == 0 || strcmp (name + k-4, ".CSV") == 0));
+   if (csv) {
+      ReadCSV (name);
+   } else {
+      ReadTSPLIB (name);
+   }
+
+   // Compute the distance between each pair of sites.
+   DistanceMatrix ();
+
+   if (tour == NULL && !csv && strlen (name) < 900) {
+      strcpy (optTour, name);
+      if (strrchr (optTour, '.') != NULL && strrchr (optTour, '.') > strrchr (optTour, '/')) {
+         *strrchr (optTour, '.') = '\0';
+      }
+      strcat (optTour, ".opt.tour");
+      E_opt = ReadTour (optTour);
+   } else if (tour != NULL) {
+      E_opt = ReadTour (tour);
+      if (E_opt == 0) {
+         printf ("%s does not hold a route through the sites.\n", tour);
+      }
+   }
+
+   return;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Read the sites from a TSPLIB file (see www.iwr.uni-heidelberg.de/groups/
+//    comopt/software/TSPLIB95): a header of "KEYWORD : value" lines, then the
+//    coordinates of the sites, numbered 1 to K, or the distances between them.
+////////////////////////////////////////////////////////////////////////////////
+void ReadTSPLIB (const char *name) {
+
+   FILE *fp;
+   char line[1000], key[100], value[100], format[100] = "FULL_MATRIX", type[100] = "";
+   int i, j, k, full, upper, diagonal;
+   float distance;
+   double x, y, PI = 3.141592;
+
+   fp = fopen (name, "r");
+   if (fp == NULL) {
+      printf ("I cannot read the file %s.\n", name);
+      Exit ();
+   }
+
+   K = 0;
+
+   while (fgets (line, 1000, fp) != NULL) {
+
+      key[0] = value[0] = '\0';
+      sscanf (line, " %99[A-Z_0-9]%*[ \t:]%99s", key, value);
+
+      if (strcmp (key, "TYPE") == 0 && strcmp (value, "TSP") != 0) {
+         printf ("This is a %s file; I can only find routes for TSP files.\n", value);
+         Exit ();
+      }
+
+      else if (strcmp (key, "DIMENSION") == 0) {
+         K = atoi (value);
+      }
+
+      else if (strcmp (key, "EDGE_WEIGHT_TYPE") == 0) {
+         strcpy (type, value);
+         if      (strcmp (type, "EUC_2D") == 0)   metric = EUC_2D;
+         else if (strcmp (type, "CEIL_2D") == 0)  metric = CEIL_2D;
+         else if (strcmp (type, "ATT") == 0)      metric = ATT;
+         else if (strcmp (type, "GEO") == 0)      metric = GEO;
+         else if (strcmp (type, "EXPLICIT") == 0) metric = EXPLICIT;
+         else {
+            printf ("I cannot work out %s distances.\n", type);
+            Exit ();
+         }
+      }
+
+      else if (strcmp (key, "EDGE_WEIGHT_FORMAT") == 0) {
+         strcpy (format, value);
+      }
+
+      // The sections that follow the header need the number of sites.
+      else if (strstr (key, "_SECTION") != NULL && K < 4) {
+         printf ("The file does not give the number of sites (at least 4).\n");
+         Exit ();
+      }
+
+      // Coordinates "k x y" for each site k, from NODE_COORD_SECTION, or just
+      //    to draw the sites from DISPLAY_DATA_SECTION.
+      else if (strcmp (key, "NODE_COORD_SECTION") == 0
+               || strcmp (key, "DISPLAY_DATA_SECTION") == 0) {
+         if (X == NULL) AllocateArrays ();
+         for (i = 1; i <= K; i++) {
+            if (fscanf (fp, "%d %lf %lf", &k, &x, &y) != 3 || k < 1 || k > K) {
+               printf ("The coordinates of site %d cannot be read.\n", i);
+               Exit ();
+            }
+            X[k] = x;
+            Y[k] = y;
+         }
+      }
+
+      // The distances, in the order of EDGE_WEIGHT_FORMAT: of each row i of
+      //    the matrix, all (FULL_MATRIX), just those past the diagonal
+      //    (UPPER_ROW), or just those before it (LOWER_ROW), and with _DIAG_
+      //    the diagonal too. Going down the columns (_COL) gives the same
+      //    entries as going across the rows of the other half.
+      else if (strcmp (key, "EDGE_WEIGHT_SECTION") == 0) {
+         if (X == NULL) AllocateArrays ();
+         D = (float *) calloc ((long long) (K+1) * (K+1), sizeof (float));
+         if (D == NULL) {
+            printf ("There is not enough memory for the distances.\n");
+            Exit ();
+         }
+         full = (strcmp (format, "FULL_MATRIX") == 0);
+         upper = (strcmp (format, "UPPER_ROW") == 0 || strcmp (format, "LOWER_COL") == 0
+                  || strcmp (format, "UPPER_DIAG_ROW") == 0 || strcmp (format, "LOWER_DIAG_COL") == 0);
+         diagonal = (strstr (format, "DIAG") != NULL);
+         if (!full && !upper && strstr (format, "LOWER") == NULL && strstr (format, "UPPER") == NULL) {
+            printf ("I cannot read distances in the format %s.\n", format);
+            Exit ();
+         }
+         for (i = 1; i <= K; i++) {
+            for (j = 1; j <= K; j++) {
+               if (full || (upper ? j > i : j < i) || (diagonal && j == i)) {
+                  if (fscanf (fp, "%f", &distance) != 1) {
+                     printf ("The distances cannot all be read.\n");
+                     Exit ();
+                  }
+                  D[(long long) i*(K+1) + j] = D[(long long) j*(K+1) + i] = distance;
+               }
+            }
+         }
+      }
+
+      else if (strcmp (key, "EOF") == 0) {
+         break;
       }
+
+   }
+   fclose (fp);
+
+   if (X == NULL || type[0] == '\0' || (metric == EXPLICIT && D == NULL)) {
+      printf ("The file does not give the sites.\n");
+      Exit ();
+   }
+
+   // Make GEO coordinates, degrees and minutes (DDD.MM), latitudes and
+   //    longitudes in radians.
+   if (metric == GEO) {
+      for (i = 1; i <= K; i++) {
+         X[i] = PI * ((int) X[i] + 5.0 * (X[i] - (int) X[i]) / 3.0) / 180.0;
+         Y[i] = PI * ((int) Y[i] + 5.0 * (Y[i] - (int) Y[i]) / 3.0) / 180.0;
+      }
+   }
+
+   return;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Read the sites from a CSV file: a line "x,y" for each one, or "name,x,y"
+//    with a number for a name. Other lines (e.g., column headings) are skipped.
+////////////////////////////////////////////////////////////////////////////////
+void ReadCSV (const char *name) {
+
+   FILE *fp;
+   char line[1000];
+   int pass, n;
+   double a, b, e;
+
+   fp = fopen (name, "r");
+   if (fp == NULL) {
+      printf ("I cannot read the file %s.\n", name);
+      Exit ();
    }
 
+   metric = PLAIN;
+
+   // Count the sites, then read them.
+   for (pass = 0; pass < 2; pass++) {
+      K = 0;
+      rewind (fp);
+      while (fgets (line, 1000, fp) != NULL) {
+         n = sscanf (line, "%lf ,%lf ,%lf", &a, &b, &e);
+         if (n < 2) continue;
+         K ++;
+         if (pass == 1) {
+            X[K] = (n == 3 ? b : a);
+            Y[K] = (n == 3 ? e : b);
+         }
+      }
+      if (pass == 0) {
+         if (K < 4) {
+            printf ("The file does not give at least 4 sites.\n");
+            Exit ();
+         }
+         AllocateArrays ();
+      }
+   }
+   fclose (fp);
 
    return;
 
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// The length of the route in the TSPLIB tour file "name": the sites in order
+//    after TOUR_SECTION, ending with -1. Returns 0 if there is no such file or
+//    it does not visit each site once.
+////////////////////////////////////////////////////////////////////////////////
+double ReadTour (const char *name) {
+
+   FILE *fp;
+   char line[1000], key[100];
+   int i, k, first, last, *seen;
+   double length = 0;
+
+   fp = fopen (name, "r");
+   if (fp == NULL) return 0;
+
+   // Skip the header.
+   key[0] = '\0';
+   while (strcmp (key, "TOUR_SECTION") != 0 && fgets (line, 1000, fp) != NULL) {
+      key[0] = '\0';
+      sscanf (line, " %99[A-Z_0-9]", key);
+   }
+
+   seen = (int *) calloc (K+1, sizeof (int));
+   first = last = 0;
+   for (i = 1; i <= K; i++) {
+      if (fscanf (fp, "%d", &k) != 1 || k < 1 || k > K || seen[k]) {
+         length = 0;
+         break;
+      }
+      seen[k] = 1;
+      if (i == 1) {
+         first = k;
+      } else {
+         length += Distance (last, k);
+      }
+      last = k;
+   }
+   if (i > K) {
+      length += Distance (last, first);
+   }
+
+   free (seen);
+   fclose (fp);
+
+   if (length > 0) {
+      printf ("The route in %s has length %.3f.\n", name, length);
+   }
+
+   return length;
+
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Randomly select the initial route, starting and ending at site 1.
 ////////////////////////////////////////////////////////////////////////////////
@@ -304,13 +803,20 @@ void RandomRoute () {
 
    int i, j, k;
 
-   printf ("I'm looking for the minimal route through a circuit board.\n");
+   if (instance == NULL) {
+      printf ("I'm looking for the minimal route through a circuit board.\n");
+   } else {
+      printf ("I'm looking for the minimal route through the %d sites in %s.\n", K, instance);
+   }
 
    // Seed the RNG.
    MTUniform();
-   
-   // Allocate array space for 183 sites and specify site coordinates.
-   InitializeArrays ();
+
+   // Allocate array space for 183 sites and specify site coordinates,
+   //    unless the sites have been read from a file.
+   if (instance == NULL) {
+      InitializeArrays ();
+   }
 
    // Initially tour them in numerical order.
    for (i = 1; i <= K; i++) {
@@ -331,7 +837,7 @@ void RandomRoute () {
    // Compute the initial route distance.
    E = 0;
    for (i = 1; i <= K; i++) {
-      E += d [c[i]] [c[i+1]];
+      E += Distance (c[i], c[i+1]);
    }
 
    // Initialize the minimal energy and where it occurs in the Markov chain.
@@ -363,6 +869,23 @@ void ReportRoute () {
    int N[10] = {0, 1000, 10000, 100000, 1000000, 10000000, 100000000};
    FILE *fp;
 
+   // Sites read from a file are not drawn on the circuit board; just the best
+   //    route is reported, as a TSPLIB tour file.
+   if (instance != NULL) {
+      if (n == 7) {
+         fp = fopen ("BestRoute.tour", "w");
+         fprintf (fp, "NAME : BestRoute\nCOMMENT : Length %.3f\nTYPE : TOUR\n", E);
+         fprintf (fp, "DIMENSION : %d\nTOUR_SECTION\n", K);
+         for (i = 1; i <= K; i++) {
+            fprintf (fp, "%d\n", best[i]);
+         }
+         fprintf (fp, "-1\nEOF\n");
+         fclose (fp);
+      }
+      n ++;
+      return;
+   }
+
    // Open the appropriate output file.
    fp = fopen (filename[n], "w");
 
@@ -34,6 +34,7 @@ SOFTWARE.
 
 // These functions are found below.
 double MTUniform (void);
+void   MTSeed (int);
 int    RandomInteger (int, int);
 void   Pause (void);
 void   Exit (void);
@@ -56,15 +57,24 @@ double GetDouble (const char *);
 // The digits in hexadecimal (base 16) are 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, a, b,
 //                                         c, d, e, f.
 ////////////////////////////////////////////////////////////////////////////////
+
+// A seed handed over by MTSeed () and not yet used; 0 if there is none.
+static unsigned int MTNewSeed = 0;
+
 double MTUniform () {
 
    static unsigned int X[1248], m[2], seeded = 0, k;
    unsigned int N, Y;
 
    // Seed the RNG when a new seed is passed or it has not yet been initialized.
-   if (!seeded) {
-      // If no seed is specified, default is 1.
-      X[0] = GetInteger ("\nPlease seed the Mersenne Twister with a positive integer... ");
+   if (!seeded || MTNewSeed) {
+      if (MTNewSeed) {
+         X[0] = MTNewSeed;
+         MTNewSeed = 0;
+      } else {
+         // If no seed is specified, default is 1.
+         X[0] = GetInteger ("\nPlease seed the Mersenne Twister with a positive integer... ");
+      }
       // Now seed X[1],X[2],...,X[623] with your favorite LCG.
       for (k = 1; k < 624; k++) {
          X[k] = 22695477 * X[k-1] + 1;
@@ -100,6 +110,18 @@ double MTUniform () {
 
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Seed (or re-seed) the Mersenne Twister without asking the user; the next call
+//    to MTUniform () starts the stream that belongs to this seed.
+////////////////////////////////////////////////////////////////////////////////
+void MTSeed (int seed) {
+
+   MTNewSeed = (seed > 0 ? seed : 1);
+
+   return;
+
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Generate an integer uniformly from among {a,...,b}. ///////////////////////
 ////////////////////////////////////////////////////////////////////////////////